@@ -0,0 +1,196 @@
+#include "cuts.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace wallgo {
+
+namespace {
+
+constexpr Direction DIRECTIONS[4] = {Direction::Up, Direction::Down, Direction::Left, Direction::Right};
+
+// Offset of the neighbor in each Direction, in cells indexed r * 7 + c.
+constexpr int STEP[4] = {-7, 7, -1, 1};
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+}  // namespace
+
+CutAnalysis::CutAnalysis(const Board& board) {
+    // Open edges of every cell, as edge indices, -1 if walled or on the border.
+    std::array<std::array<int8_t, 4>, 49> edges;
+    std::array<int8_t, 49> piece;
+    for (int cell = 0; cell < 49; ++cell) {
+        Position pos{cell / 7, cell % 7};
+        const Cell& c = board.get(pos);
+        for (int d = 0; d < 4; ++d) {
+            edges[cell][d] = c.wall(DIRECTIONS[d]) == WallType::None ? zobrist::edge_index(pos, DIRECTIONS[d]) : -1;
+        }
+        piece[cell] = c.piece() ? static_cast<int8_t>(c.piece()->owner) : 0;
+    }
+
+    // Iterative DFS. order lists cells by entry time; parent_edge is -1 for roots.
+    std::array<int8_t, 49> parent, parent_edge, order;
+    std::array<int8_t, 49>& region = region_;
+    std::array<bool, zobrist::EDGE_COUNT> tree = {};
+    entry_.fill(-1);
+    child_.fill(-1);
+    int time = 0;
+    std::vector<int> roots;
+    for (int root = 0; root < 49; ++root) {
+        if (entry_[root] != -1) continue;
+        roots.push_back(root);
+        std::array<std::pair<int8_t, int8_t>, 49> stack;  // Cell and next direction to try
+        int top = 0;
+        stack[top++] = {static_cast<int8_t>(root), 0};
+        entry_[root] = static_cast<int8_t>(time);
+        order[time++] = static_cast<int8_t>(root);
+        parent_edge[root] = -1;
+        region[root] = static_cast<int8_t>(roots.size() - 1);
+        while (top > 0) {
+            auto& [cell, d] = stack[top - 1];
+            if (d == 4) {
+                exit_[cell] = static_cast<int8_t>(time);
+                --top;
+                continue;
+            }
+            int edge = edges[cell][d];
+            int next = cell + STEP[d];
+            ++d;
+            if (edge < 0 || entry_[next] != -1) continue;
+            tree[edge] = true;
+            child_[edge] = static_cast<int8_t>(next);
+            parent[next] = cell;
+            parent_edge[next] = static_cast<int8_t>(edge);
+            region[next] = region[cell];
+            entry_[next] = static_cast<int8_t>(time);
+            order[time++] = static_cast<int8_t>(next);
+            stack[top++] = {static_cast<int8_t>(next), 0};
+        }
+    }
+
+    // Pieces and sizes of every region, to skip those that are not contested.
+    std::vector<std::array<int, 3>> pieces(roots.size(), {0, 0, 0});
+    std::vector<int> size(roots.size(), 0);
+    for (int cell = 0; cell < 49; ++cell) {
+        ++pieces[region[cell]][piece[cell]];
+        ++size[region[cell]];
+    }
+    for (int cell = 0; cell < 49; ++cell) {
+        region_size_[cell] = static_cast<int8_t>(size[region[cell]]);
+    }
+
+    // Labels of non-tree edges are toggled into both endpoints; summing over subtrees then gives each tree edge the
+    // XOR of the labels of the cycles through it. Fixed seeds keep the results reproducible.
+    uint64_t state = 0x5eed;
+    std::array<uint64_t, 49> sum = {};
+    for (int cell = 0; cell < 49; ++cell) {
+        for (int d = 1; d < 4; d += 2) {  // Down and Right, so that each edge is seen once
+            int edge = edges[cell][d];
+            if (edge < 0 || tree[edge]) continue;
+            label_[edge] = splitmix64(state);
+            sum[cell] ^= label_[edge];
+            sum[cell + STEP[d]] ^= label_[edge];
+        }
+    }
+    for (int i = 48; i >= 0; --i) {
+        int cell = order[i];
+        if (parent_edge[cell] < 0) continue;
+        label_[parent_edge[cell]] = sum[cell];
+        sum[parent[cell]] ^= sum[cell];
+    }
+
+    // Group edges of contested regions by label.
+    std::vector<std::pair<uint64_t, int>> labelled;
+    for (int cell = 0; cell < 49; ++cell) {
+        const std::array<int, 3>& count = pieces[region[cell]];
+        if (count[static_cast<int>(PlayerColor::Red)] == 0 || count[static_cast<int>(PlayerColor::Blue)] == 0) continue;
+        for (int d = 1; d < 4; d += 2) {
+            int edge = edges[cell][d];
+            if (edge >= 0) labelled.push_back({label_[edge], edge});
+        }
+    }
+    std::sort(labelled.begin(), labelled.end());
+    for (size_t i = 0; i < labelled.size();) {
+        size_t j = i;
+        while (j < labelled.size() && labelled[j].first == labelled[i].first) ++j;
+        for (size_t k = i; k < j; ++k) {
+            int edge = labelled[k].second;
+            if (labelled[i].first == 0) {
+                kind_[edge] = Kind::Bridge;
+                bridges_.push_back(edge);
+            } else if (j - i >= 2) {
+                kind_[edge] = Kind::NearBridge;
+                near_bridges_.push_back(edge);
+            }
+        }
+        i = j;
+    }
+}
+
+std::vector<int> CutAnalysis::partners(int edge) const {
+    std::vector<int> result;
+    if (kind_[edge] != Kind::NearBridge) return result;
+    for (int other : near_bridges_) {
+        if (other != edge && label_[other] == label_[edge]) result.push_back(other);
+    }
+    return result;
+}
+
+bool CutAnalysis::beyond(int bridge, Position pos) const {
+    int child = child_[bridge], cell = pos.r * 7 + pos.c;
+    return entry_[cell] >= entry_[child] && entry_[cell] < exit_[child];
+}
+
+std::vector<SealingMove> sealing_moves(const Board& board, PlayerColor player) {
+    CutAnalysis cuts(board);
+    std::vector<SealingMove> result;
+    if (cuts.bridges().empty() && cuts.near_bridges().empty()) return result;
+
+    std::vector<Piece> pieces = board.get_pieces(PlayerColor::Red);
+    for (const Piece& piece : board.get_pieces(PlayerColor::Blue)) {
+        pieces.push_back(piece);
+    }
+    for (PackedMove move : board.get_packed_moves(player)) {
+        Position from = board.get_piece(player, move.piece_id()).pos;
+        Position to = from.move(move.direction1()).move(move.direction2());
+        int edge = zobrist::edge_index(to, move.wall_placement_direction());
+        CutAnalysis::Kind kind = cuts.kind(edge);
+        if (kind == CutAnalysis::Kind::None) continue;
+
+        int gain = 0;
+        if (kind == CutAnalysis::Kind::Bridge) {
+            // Colors on each side of the bridge, with the moving piece where it ends up.
+            int colors[2] = {0, 0};
+            for (const Piece& piece : pieces) {
+                bool moved = piece.owner == player && piece.id == move.piece_id();
+                Position pos = moved ? to : piece.pos;
+                if (cuts.region(pos) != cuts.region(to)) continue;
+                colors[cuts.beyond(edge, pos)] |= static_cast<int>(piece.owner);
+            }
+            int sizes[2] = {cuts.region_size(edge) - cuts.beyond_size(edge), cuts.beyond_size(edge)};
+            for (int side = 0; side < 2; ++side) {
+                if (colors[side] == static_cast<int>(player)) gain += sizes[side];
+                if (colors[side] == (3 ^ static_cast<int>(player))) gain -= sizes[side];
+            }
+        }
+        result.push_back({move.unpack(), kind, gain});
+    }
+
+    auto tier = [](const SealingMove& m) {
+        if (m.kind == CutAnalysis::Kind::NearBridge) return 1;
+        return m.gain > 0 ? 0 : 2;
+    };
+    std::stable_sort(result.begin(), result.end(), [&](const SealingMove& a, const SealingMove& b) {
+        if (tier(a) != tier(b)) return tier(a) < tier(b);
+        return a.gain > b.gain;
+    });
+    return result;
+}
+
+}  // namespace wallgo
@@ -0,0 +1,72 @@
+#ifndef WALLGO_CUTS_H
+#define WALLGO_CUTS_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "zobrist.h"
+
+namespace wallgo {
+
+// Edges of contested regions whose walls come close to sealing something off.
+//
+// The graph has a node per cell and an edge per interior edge without a wall, as in Board::get_territory; pieces do not
+// block it. A bridge is an edge whose wall alone splits its region. A near-bridge is an edge in a 2-edge cut: a wall on
+// it makes each other edge of the cut a bridge, so it threatens a seal on the next move.
+//
+// Both are found in one pass with cycle-space labels. Every edge outside a DFS tree gets a random 64-bit label, and
+// every tree edge gets the XOR of the labels of the non-tree edges whose cycle runs through it. An edge is a bridge if
+// its label is zero, and two edges form a 2-edge cut if their labels are equal; with 64-bit labels the chance of a
+// false match is negligible.
+class CutAnalysis {
+   public:
+    enum class Kind : uint8_t { None, Bridge, NearBridge };
+
+   private:
+    std::array<Kind, zobrist::EDGE_COUNT> kind_ = {};
+    std::array<uint64_t, zobrist::EDGE_COUNT> label_ = {};
+    std::array<int8_t, zobrist::EDGE_COUNT> child_;  // For tree edges, the endpoint farther from the DFS root
+    std::array<int8_t, 49> entry_, exit_;            // DFS times; a subtree's cells have consecutive entry times
+    std::array<int8_t, 49> region_, region_size_;
+    std::vector<int> bridges_, near_bridges_;
+
+   public:
+    explicit CutAnalysis(const Board& board);
+
+    // Kind of an interior edge (see zobrist::edge_index). Edges outside contested regions are Kind::None.
+    Kind kind(int edge) const { return kind_[edge]; }
+    const std::vector<int>& bridges() const { return bridges_; }
+    const std::vector<int>& near_bridges() const { return near_bridges_; }
+
+    // The other edges that form a 2-edge cut with a near-bridge.
+    std::vector<int> partners(int edge) const;
+
+    // Id of the region of a cell.
+    int region(Position pos) const { return region_[pos.r * 7 + pos.c]; }
+
+    // For a bridge, whether the cell at pos is on the side of it that does not hold its region's DFS root.
+    bool beyond(int bridge, Position pos) const;
+
+    // For a bridge, the number of cells beyond it, and in its whole region.
+    int beyond_size(int bridge) const { return exit_[child_[bridge]] - entry_[child_[bridge]]; }
+    int region_size(int bridge) const { return region_size_[child_[bridge]]; }
+};
+
+// A legal move that walls a bridge or near-bridge, with the cells it seals: the sizes of the parts a bridge splits off
+// that hold only the mover's pieces, minus those that hold only the opponent's. Pieces are counted where they stand
+// after the move. Always 0 for near-bridges.
+struct SealingMove {
+    Move move;
+    CutAnalysis::Kind kind;
+    int gain;
+};
+
+// Returns the legal moves of player that wall a bridge or near-bridge of a contested region, best first: bridges that
+// seal cells for player by gain, then near-bridges, then the remaining bridges by gain.
+std::vector<SealingMove> sealing_moves(const Board& board, PlayerColor player);
+
+}  // namespace wallgo
+
+#endif  // WALLGO_CUTS_H
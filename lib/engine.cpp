@@ -0,0 +1,410 @@
+#include "engine.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <sstream>
+#include <stdexcept>
+
+#include "instrumentation.h"
+
+namespace wallgo {
+
+namespace {
+
+constexpr double DECISION_SLACK = 1;  // Seconds past the player's remaining time before a decision is given up
+constexpr double HANG_SECONDS = 10;   // Seconds other commands, and decisions under node or depth limits, may take
+constexpr std::chrono::milliseconds QUIT_GRACE(500);  // How long an engine may take to exit after quit
+
+std::chrono::steady_clock::time_point deadline_after(double seconds) {
+    return std::chrono::steady_clock::now() +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+std::string encode_position(Position pos) { return {static_cast<char>('0' + pos.r), static_cast<char>('0' + pos.c)}; }
+
+std::optional<Position> decode_position(const std::string& data) {
+    if (data.size() != 2 || data[0] < '0' || data[0] > '9' || data[1] < '0' || data[1] > '9') return std::nullopt;
+    return Position{data[0] - '0', data[1] - '0'};
+}
+
+std::string format_stats(const SearchStats& stats) {
+    std::ostringstream line;
+    line << "stats nodes=" << stats.nodes << " expanded=" << stats.expanded << " children=" << stats.children
+         << " evaluations=" << stats.evaluations << " tt_probes=" << stats.tt_probes << " tt_hits=" << stats.tt_hits
+         << " depth=" << stats.depth << " movegen_s=" << stats.movegen_seconds << " bfs_s=" << stats.bfs_seconds
+         << " eval_s=" << stats.eval_seconds;
+    return line.str();
+}
+
+// Reads the fields of a stats line after "stats". Unknown keys are skipped, so engines may report more.
+SearchStats parse_stats(std::istringstream& fields) {
+    SearchStats stats;
+    std::string field;
+    while (fields >> field) {
+        size_t eq = field.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = field.substr(0, eq);
+        std::istringstream value(field.substr(eq + 1));
+        if (key == "nodes") {
+            value >> stats.nodes;
+        } else if (key == "expanded") {
+            value >> stats.expanded;
+        } else if (key == "children") {
+            value >> stats.children;
+        } else if (key == "evaluations") {
+            value >> stats.evaluations;
+        } else if (key == "tt_probes") {
+            value >> stats.tt_probes;
+        } else if (key == "tt_hits") {
+            value >> stats.tt_hits;
+        } else if (key == "depth") {
+            value >> stats.depth;
+        } else if (key == "movegen_s") {
+            value >> stats.movegen_seconds;
+        } else if (key == "bfs_s") {
+            value >> stats.bfs_seconds;
+        } else if (key == "eval_s") {
+            value >> stats.eval_seconds;
+        }
+    }
+    return stats;
+}
+
+// Stats of a decision: the counters the library recorded while the player decided plus what it reports itself.
+SearchStats decision_stats(const Player& player, SearchStats recorded) {
+    if (const SearchStats* reported = player.search_stats()) {
+        recorded += *reported;
+    }
+    return recorded;
+}
+
+}  // namespace
+
+int serve_engine(std::istream& in, std::ostream& out, const std::function<std::unique_ptr<Player>()>& make_player) {
+    std::unique_ptr<Player> player;
+    std::shared_ptr<Game> game;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command)) continue;
+        if (command == "quit") return 0;
+        try {
+            if (command == "wallgo") {
+                out << "ready" << std::endl;
+                continue;
+            }
+            if (command == "init") {
+                int color, seed;
+                std::string encoded;
+                if (!(words >> color >> seed >> encoded) || (color != 1 && color != 2)) {
+                    throw std::runtime_error("Malformed init");
+                }
+                game = std::make_shared<Game>(Game::decode(encoded));
+                player = make_player();
+                player->init(static_cast<PlayerColor>(color), game, seed);
+                out << "ready" << std::endl;
+                continue;
+            }
+            if (!player) throw std::runtime_error("No game in progress");
+
+            if (command == "limits") {
+                SearchLimits limits;
+                if (!(words >> limits.remaining >> limits.increment >> limits.nodes >> limits.depth)) {
+                    throw std::runtime_error("Malformed limits");
+                }
+                player->set_limits(limits);
+                out << "ok" << std::endl;
+            } else if (command == "place") {
+                PieceId piece_id;
+                std::vector<Position> valid_positions;
+                std::string cell;
+                if (!(words >> piece_id)) throw std::runtime_error("Malformed place");
+                while (words >> cell) {
+                    std::optional<Position> pos = decode_position(cell);
+                    if (!pos) throw std::runtime_error("Malformed cell " + cell);
+                    valid_positions.push_back(*pos);
+                }
+                SearchStats stats;
+                Position pos;
+                {
+                    WALLGO_RECORD_SEARCH(stats);
+                    pos = player->place(piece_id, valid_positions);
+                }
+                out << format_stats(decision_stats(*player, stats)) << '\n';
+                out << "place " << encode_position(pos) << std::endl;
+            } else if (command == "move") {
+                std::vector<Move> valid_moves;
+                std::string code;
+                while (words >> code) {
+                    valid_moves.push_back(Move::decode(code));
+                }
+                SearchStats stats;
+                std::optional<Move> chosen;
+                {
+                    WALLGO_RECORD_SEARCH(stats);
+                    chosen = player->move(valid_moves);
+                }
+                out << format_stats(decision_stats(*player, stats)) << '\n';
+                out << "move " << chosen->encode() << std::endl;
+            } else if (command == "placed") {
+                std::string data;
+                std::optional<Position> pos;
+                if (!(words >> data) || data.size() != 4 || !(pos = decode_position(data.substr(0, 2))) ||
+                    (data[2] != '1' && data[2] != '2') || data[3] < '0' || data[3] > '9') {
+                    throw std::runtime_error("Malformed placed");
+                }
+                Piece piece{static_cast<PlayerColor>(data[2] - '0'), *pos, data[3] - '0'};
+                game->place_piece(piece.pos, piece.owner, piece.id);
+                player->on_placement(piece);
+                out << "ok" << std::endl;
+            } else if (command == "moved") {
+                std::string code;
+                if (!(words >> code)) throw std::runtime_error("Malformed moved");
+                Move move = Move::decode(code);
+                game->apply_move(move);
+                player->on_move(move);
+                out << "ok" << std::endl;
+            } else if (command == "result") {
+                int winner, reason;
+                std::string encoded;
+                if (!(words >> winner >> reason >> encoded)) throw std::runtime_error("Malformed result");
+                GameOutcome outcome{static_cast<PlayerColor>(winner), static_cast<Reason>(reason), encoded, "", {}};
+                player->on_game_over(outcome);
+                player.reset();
+                game.reset();
+                out << "ok" << std::endl;
+            } else {
+                throw std::runtime_error("Unknown command " + command);
+            }
+        } catch (const std::exception& e) {
+            out << "error " << e.what() << std::endl;
+        }
+    }
+    return 0;
+}
+
+// EngineProcess implementation
+
+EngineProcess::EngineProcess(const std::string& command) {
+    signal(SIGPIPE, SIG_IGN);
+    int to[2], from[2];
+    if (pipe2(to, O_CLOEXEC) != 0) {
+        throw std::runtime_error(std::string("Cannot create pipe: ") + std::strerror(errno));
+    }
+    if (pipe2(from, O_CLOEXEC) != 0) {
+        close(to[0]);
+        close(to[1]);
+        throw std::runtime_error(std::string("Cannot create pipe: ") + std::strerror(errno));
+    }
+    pid_ = fork();
+    if (pid_ < 0) {
+        for (int fd : {to[0], to[1], from[0], from[1]}) close(fd);
+        throw std::runtime_error(std::string("Cannot start engine: ") + std::strerror(errno));
+    }
+    if (pid_ == 0) {
+        dup2(to[0], STDIN_FILENO);
+        dup2(from[1], STDOUT_FILENO);
+        for (int fd : {to[0], to[1], from[0], from[1]}) close(fd);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(to[0]);
+    close(from[1]);
+    to_engine_ = to[1];
+    from_engine_ = from[0];
+
+    std::optional<std::string> answer;
+    if (!send("wallgo") || !(answer = receive(deadline_after(HANG_SECONDS))) || *answer != "ready") {
+        stop();
+        throw std::runtime_error("Engine did not answer the handshake: " + command);
+    }
+}
+
+EngineProcess::~EngineProcess() {
+    if (pid_ < 0) return;
+    send("quit");
+    close(to_engine_);
+    close(from_engine_);
+    auto deadline = std::chrono::steady_clock::now() + QUIT_GRACE;
+    while (waitpid(pid_, nullptr, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            kill(pid_, SIGKILL);
+            waitpid(pid_, nullptr, 0);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void EngineProcess::stop() {
+    if (pid_ < 0) return;
+    close(to_engine_);
+    close(from_engine_);
+    to_engine_ = from_engine_ = -1;
+    kill(pid_, SIGKILL);
+    waitpid(pid_, nullptr, 0);
+    pid_ = -1;
+}
+
+bool EngineProcess::send(const std::string& line) {
+    if (pid_ < 0) return false;
+    std::string data = line + '\n';
+    for (size_t written = 0; written < data.size();) {
+        ssize_t n = write(to_engine_, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+std::optional<std::string> EngineProcess::receive(std::chrono::steady_clock::time_point deadline) {
+    if (pid_ < 0) return std::nullopt;
+    while (true) {
+        size_t newline = buffer_.find('\n');
+        if (newline != std::string::npos) {
+            std::string line = buffer_.substr(0, newline);
+            buffer_.erase(0, newline + 1);
+            if (line.compare(0, 5, "info ") == 0 || line == "info") continue;
+            return line;
+        }
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) return std::nullopt;
+        pollfd readable{from_engine_, POLLIN, 0};
+        int ready = poll(&readable, 1, static_cast<int>(std::min<int64_t>(left.count(), INT32_MAX)));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) return std::nullopt;
+        if (ready == 0) continue;
+        char data[4096];
+        ssize_t n = read(from_engine_, data, sizeof(data));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return std::nullopt;
+        buffer_.append(data, n);
+    }
+}
+
+// EnginePlayer implementation
+
+EnginePlayer::EnginePlayer(std::shared_ptr<EngineProcess> engine) : engine_(std::move(engine)) {}
+
+void EnginePlayer::fail(const std::string& message, Reason reason) {
+    if (error_.empty()) {
+        error_ = message;
+        reason_ = reason;
+        std::cerr << "Engine " << engine_->pid() << ": " << message << std::endl;
+    }
+}
+
+std::optional<std::string> EnginePlayer::request(const std::string& command, const std::string& kind,
+                                                 double seconds) {
+    if (!error_.empty()) return std::nullopt;
+    if (!engine_->send(command)) {
+        fail("engine closed its input");
+        return std::nullopt;
+    }
+    auto deadline = deadline_after(seconds);
+    while (std::optional<std::string> line = engine_->receive(deadline)) {
+        std::istringstream words(*line);
+        std::string word;
+        words >> word;
+        if (word == "stats") {
+            stats_ = parse_stats(words);
+            has_stats_ = true;
+        } else if (word == kind) {
+            std::string rest;
+            std::getline(words >> std::ws, rest);
+            return rest;
+        } else {
+            fail("unexpected answer to " + command.substr(0, command.find(' ')) + ": " + *line);
+            return std::nullopt;
+        }
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+        // The answer may still come, so the process is out of step with any later command.
+        fail("no answer to " + command.substr(0, command.find(' ')) + " within " + std::to_string(seconds) + "s",
+             OPPONENT_TLE);
+        engine_->stop();
+    } else {
+        fail("engine exited");
+    }
+    return std::nullopt;
+}
+
+double EnginePlayer::decision_seconds() const {
+    return limits_.nodes || limits_.depth ? HANG_SECONDS : limits_.remaining + DECISION_SLACK;
+}
+
+void EnginePlayer::notify(const std::string& command) { request(command, "ok", HANG_SECONDS); }
+
+void EnginePlayer::init(PlayerColor player, std::shared_ptr<const Game> game, int seed) {
+    std::ostringstream command;
+    command << "init " << static_cast<int>(player) << ' ' << seed << ' ' << game->encode();
+    request(command.str(), "ready", HANG_SECONDS);
+}
+
+Position EnginePlayer::place(PieceId pieceId, const std::vector<Position>& valid_positions) {
+    std::string command = "place " + std::to_string(pieceId);
+    for (Position pos : valid_positions) {
+        command += ' ' + encode_position(pos);
+    }
+    has_stats_ = false;
+    if (std::optional<std::string> answer = request(command, "place", decision_seconds())) {
+        if (std::optional<Position> pos = decode_position(*answer)) return *pos;
+        fail("malformed placement: " + *answer);
+    }
+    throw Forfeit(reason_, "engine " + error_);
+}
+
+Move EnginePlayer::move(const std::vector<Move>& valid_moves) {
+    std::string command = "move";
+    command.reserve(5 + 4 * valid_moves.size());
+    for (const Move& move : valid_moves) {
+        command += ' ' + move.encode();
+    }
+    has_stats_ = false;
+    if (std::optional<std::string> answer = request(command, "move", decision_seconds())) {
+        try {
+            PackedMove chosen(Move::decode(*answer));
+            for (const Move& move : valid_moves) {
+                if (PackedMove(move) == chosen) return move;
+            }
+            fail("illegal move: " + *answer);
+        } catch (const std::runtime_error&) {
+            fail("malformed move: " + *answer);
+        }
+    }
+    throw Forfeit(reason_, "engine " + error_);
+}
+
+void EnginePlayer::set_limits(const SearchLimits& limits) {
+    limits_ = limits;
+    std::ostringstream command;
+    command.precision(17);
+    command << "limits " << limits.remaining << ' ' << limits.increment << ' ' << limits.nodes << ' ' << limits.depth;
+    notify(command.str());
+}
+
+void EnginePlayer::on_placement(const Piece& piece) {
+    notify("placed " + encode_position(piece.pos) + std::to_string(static_cast<int>(piece.owner)) +
+           std::to_string(piece.id));
+}
+
+void EnginePlayer::on_move(const Move& move) { notify("moved " + move.encode()); }
+
+void EnginePlayer::on_game_over(const GameOutcome& outcome) {
+    std::ostringstream command;
+    command << "result " << static_cast<int>(outcome.winner) << ' ' << static_cast<int>(outcome.reason) << ' '
+            << outcome.encoded_game;
+    notify(command.str());
+}
+
+}  // namespace wallgo
@@ -0,0 +1,116 @@
+#ifndef WALLGO_ENGINE_H
+#define WALLGO_ENGINE_H
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+// A line-based protocol for running a player in its own process, so that a crash or runaway allocation loses a game
+// instead of the whole match, and engines built with different flags can play each other. The controller writes one
+// command per line to the engine's stdin; the engine answers on stdout. Positions are written as two digits rc and
+// moves in their 3-character encoding (see Move::encode).
+//
+//   wallgo                                   -> ready       handshake, sent once after the engine starts
+//   init <color> <seed> <game>               -> ready       starts a game as color 1 or 2 from the game string so far
+//   limits <remaining> <inc> <nodes> <depth> -> ok          limits of the next decision, see SearchLimits
+//   place <id> <rc>...                       -> place <rc>  place piece id on one of the listed cells
+//   move <move>...                           -> move <move> choose one of the listed moves
+//   placed <rcoi>                            -> ok          a placement by either player, as in the game string
+//   moved <move>                             -> ok          a move by either player
+//   result <winner> <reason> <game>          -> ok          the game is over; the engine drops its player
+//   quit                                                    the engine exits
+//
+// Before answering place or move, the engine may write "stats key=value..." with the fields of SearchStats, and it
+// may write "info ..." lines at any time, which are ignored. Commands it cannot carry out get "error <message>"
+// instead of their answer. Every command but quit is answered, so an error is reported for the command that caused
+// it and never read as the answer to a later one.
+// An engine process serves any number of games in turn, which saves its startup cost for every game after the first.
+
+// Serves the protocol on in and out until quit or the end of input, creating a player with make_player for every
+// game. Returns the exit status for the engine's main.
+int serve_engine(std::istream& in, std::ostream& out, const std::function<std::unique_ptr<Player>()>& make_player);
+
+// An engine running as a child process, talking over a pair of pipes. Destroying it sends quit and waits briefly for
+// the process to exit before killing it. SIGPIPE is ignored from the first start on, so that writing to an engine
+// that died fails instead of killing the controller.
+class EngineProcess {
+   private:
+    pid_t pid_ = -1;
+    int to_engine_ = -1, from_engine_ = -1;
+    std::string buffer_;  // Bytes read past the last line returned
+
+   public:
+    // Runs command with /bin/sh and waits for the handshake. Throws std::runtime_error if the engine cannot be
+    // started or does not answer it.
+    explicit EngineProcess(const std::string& command);
+    ~EngineProcess();
+
+    EngineProcess(const EngineProcess&) = delete;
+    EngineProcess& operator=(const EngineProcess&) = delete;
+
+    // Writes a command followed by a newline. Returns false if the engine has closed its input.
+    bool send(const std::string& line);
+
+    // Returns the next line from the engine other than info lines, or nullopt once it has closed its output or the
+    // deadline has passed.
+    std::optional<std::string> receive(std::chrono::steady_clock::time_point deadline);
+
+    // Kills the engine at once, e.g. when it stopped answering. Later commands fail as if it had exited.
+    void stop();
+
+    pid_t pid() const { return pid_; }
+};
+
+// A player whose decisions are made by an engine process. Several players may share one process as long as they do
+// not play at the same time, e.g. one after another in a match. If the engine dies or answers something malformed or
+// illegal, the next decision throws Forfeit with OPPONENT_ILLEGAL_MOVE, so the game is lost rather than the match,
+// and error() tells what happened. A decision gets the player's remaining time plus a second to answer, other
+// commands and decisions under node or depth limits ten seconds; an engine that overruns this is killed and the
+// decision throws Forfeit with OPPONENT_TLE.
+class EnginePlayer : public Player {
+   private:
+    std::shared_ptr<EngineProcess> engine_;
+    SearchLimits limits_{};
+    SearchStats stats_;
+    bool has_stats_ = false;
+    std::string error_;
+    Reason reason_ = OPPONENT_ILLEGAL_MOVE;  // How the game is lost because of error_
+
+    // Sends a command that expects an answer starting with kind within seconds and returns the rest of the answer, or
+    // nullopt after recording the error.
+    std::optional<std::string> request(const std::string& command, const std::string& kind, double seconds);
+    void notify(const std::string& command);
+    void fail(const std::string& message, Reason reason = OPPONENT_ILLEGAL_MOVE);
+
+    // Seconds the engine gets to answer the next decision, from the last limits.
+    double decision_seconds() const;
+
+   public:
+    explicit EnginePlayer(std::shared_ptr<EngineProcess> engine);
+
+    void init(PlayerColor player, std::shared_ptr<const Game> game, int seed) override;
+    Position place(PieceId pieceId, const std::vector<Position>& valid_positions) override;
+    Move move(const std::vector<Move>& valid_moves) override;
+    void set_limits(const SearchLimits& limits) override;
+    void on_placement(const Piece& piece) override;
+    void on_move(const Move& move) override;
+    void on_game_over(const GameOutcome& outcome) override;
+    const SearchStats* search_stats() const override { return has_stats_ ? &stats_ : nullptr; }
+
+    // The first failure of the engine in this game, empty if there was none.
+    const std::string& error() const { return error_; }
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_ENGINE_H
@@ -0,0 +1,288 @@
+#include "eval_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WALLGO_X86 1
+#include <immintrin.h>
+#endif
+
+namespace wallgo {
+namespace kernels {
+
+namespace {
+
+// Plain C++ versions, also the reference for the SIMD ones.
+namespace scalar {
+
+int table_index(uint8_t d) { return d >= UNREACHABLE ? 15 : std::min<int>(d, 14); }
+
+int voronoi(const PaddedField& mine, const PaddedField& theirs) {
+    int score = 0;
+    for (int i = 0; i < 64; ++i) {
+        score += (mine.d[i] < theirs.d[i]) - (theirs.d[i] < mine.d[i]);
+    }
+    return score;
+}
+
+float ratio(const PaddedField& mine, const PaddedField& theirs) {
+    float score = 0;
+    for (int i = 0; i < 64; ++i) {
+        float m = mine.d[i], t = theirs.d[i];
+        bool m_reach = m < UNREACHABLE, t_reach = t < UNREACHABLE;
+        score += m_reach && t_reach ? (t - m) / std::max(m + t, 1.0f) : float(m_reach) - float(t_reach);
+    }
+    return score;
+}
+
+float pair_table(const PaddedField& mine, const PaddedField& theirs, const PairTable& table) {
+    float score = 0;
+    for (int i = 0; i < 64; ++i) {
+        score += table.score[table_index(mine.d[i]) * 16 + table_index(theirs.d[i])];
+    }
+    return score;
+}
+
+void add_decay(const PaddedField& field, const DecayTable& table, std::array<float, 64>& control) {
+    for (int i = 0; i < 64; ++i) {
+        control[i] += table.w[table_index(field.d[i])];
+    }
+}
+
+float control_share(const std::array<float, 64>& mine, const std::array<float, 64>& theirs, float epsilon) {
+    float score = 0;
+    for (int i = 0; i < 64; ++i) {
+        score += (mine[i] - theirs[i]) / (mine[i] + theirs[i] + epsilon);
+    }
+    return score;
+}
+
+}  // namespace scalar
+
+#ifdef WALLGO_X86
+
+namespace sse2 {
+
+float horizontal_sum(__m128 v) {
+    __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+// Widens 4 bytes starting at p to floats.
+__m128 load_4_bytes(const uint8_t* p) {
+    int32_t bytes;
+    std::copy(p, p + 4, reinterpret_cast<uint8_t*>(&bytes));
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+}
+
+__m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+int voronoi(const PaddedField& mine, const PaddedField& theirs) {
+    int score = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(&mine.d[i]));
+        __m128i t = _mm_load_si128(reinterpret_cast<const __m128i*>(&theirs.d[i]));
+        score += __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(m, t)));
+        score -= __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(t, m)));
+    }
+    return score;
+}
+
+float ratio(const PaddedField& mine, const PaddedField& theirs) {
+    const __m128 unreachable = _mm_set1_ps(UNREACHABLE);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 acc = _mm_setzero_ps();
+    for (int i = 0; i < 64; i += 4) {
+        __m128 m = load_4_bytes(&mine.d[i]);
+        __m128 t = load_4_bytes(&theirs.d[i]);
+        __m128 m_reach = _mm_cmplt_ps(m, unreachable);
+        __m128 t_reach = _mm_cmplt_ps(t, unreachable);
+        __m128 both = _mm_and_ps(m_reach, t_reach);
+        __m128 q = _mm_div_ps(_mm_sub_ps(t, m), _mm_max_ps(_mm_add_ps(m, t), one));
+        __m128 single = _mm_sub_ps(_mm_and_ps(m_reach, one), _mm_and_ps(t_reach, one));
+        acc = _mm_add_ps(acc, select(both, q, single));
+    }
+    return horizontal_sum(acc);
+}
+
+float control_share(const std::array<float, 64>& mine, const std::array<float, 64>& theirs, float epsilon) {
+    const __m128 eps = _mm_set1_ps(epsilon);
+    __m128 acc = _mm_setzero_ps();
+    for (int i = 0; i < 64; i += 4) {
+        __m128 m = _mm_loadu_ps(&mine[i]);
+        __m128 t = _mm_loadu_ps(&theirs[i]);
+        acc = _mm_add_ps(acc, _mm_div_ps(_mm_sub_ps(m, t), _mm_add_ps(_mm_add_ps(m, t), eps)));
+    }
+    return horizontal_sum(acc);
+}
+
+}  // namespace sse2
+
+#define WALLGO_AVX2 __attribute__((target("avx2")))
+
+namespace avx2 {
+
+WALLGO_AVX2 float horizontal_sum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuffled = _mm_movehdup_ps(sum);
+    sum = _mm_add_ps(sum, shuffled);
+    return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(shuffled, sum)));
+}
+
+// Widens 8 bytes starting at p to 32-bit lanes.
+WALLGO_AVX2 __m256i load_8_bytes(const uint8_t* p) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+// Loads 8 distances as table indices: clamped to 14, with UNREACHABLE mapped to 15.
+WALLGO_AVX2 __m256i load_8_indices(const uint8_t* p) {
+    __m256i d = load_8_bytes(p);
+    __m256i unreachable = _mm256_cmpgt_epi32(d, _mm256_set1_epi32(UNREACHABLE - 1));
+    return _mm256_sub_epi32(_mm256_min_epi32(d, _mm256_set1_epi32(14)), unreachable);
+}
+
+WALLGO_AVX2 int voronoi(const PaddedField& mine, const PaddedField& theirs) {
+    int score = 0;
+    for (int i = 0; i < 64; i += 32) {
+        __m256i m = _mm256_load_si256(reinterpret_cast<const __m256i*>(&mine.d[i]));
+        __m256i t = _mm256_load_si256(reinterpret_cast<const __m256i*>(&theirs.d[i]));
+        score += __builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(t, m))));
+        score -= __builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(m, t))));
+    }
+    return score;
+}
+
+WALLGO_AVX2 float ratio(const PaddedField& mine, const PaddedField& theirs) {
+    const __m256 unreachable = _mm256_set1_ps(UNREACHABLE);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < 64; i += 8) {
+        __m256 m = _mm256_cvtepi32_ps(load_8_bytes(&mine.d[i]));
+        __m256 t = _mm256_cvtepi32_ps(load_8_bytes(&theirs.d[i]));
+        __m256 m_reach = _mm256_cmp_ps(m, unreachable, _CMP_LT_OQ);
+        __m256 t_reach = _mm256_cmp_ps(t, unreachable, _CMP_LT_OQ);
+        __m256 both = _mm256_and_ps(m_reach, t_reach);
+        __m256 q = _mm256_div_ps(_mm256_sub_ps(t, m), _mm256_max_ps(_mm256_add_ps(m, t), one));
+        __m256 single = _mm256_sub_ps(_mm256_and_ps(m_reach, one), _mm256_and_ps(t_reach, one));
+        acc = _mm256_add_ps(acc, _mm256_blendv_ps(single, q, both));
+    }
+    return horizontal_sum(acc);
+}
+
+WALLGO_AVX2 float pair_table(const PaddedField& mine, const PaddedField& theirs, const PairTable& table) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < 64; i += 8) {
+        __m256i m = load_8_indices(&mine.d[i]);
+        __m256i t = load_8_indices(&theirs.d[i]);
+        __m256i index = _mm256_add_epi32(_mm256_slli_epi32(m, 4), t);
+        acc = _mm256_add_ps(acc, _mm256_i32gather_ps(table.score.data(), index, 4));
+    }
+    return horizontal_sum(acc);
+}
+
+WALLGO_AVX2 void add_decay(const PaddedField& field, const DecayTable& table, std::array<float, 64>& control) {
+    const __m256i seven = _mm256_set1_epi32(7);
+    const __m256 low = _mm256_load_ps(&table.w[0]);
+    const __m256 high = _mm256_load_ps(&table.w[8]);
+    for (int i = 0; i < 64; i += 8) {
+        __m256i index = load_8_indices(&field.d[i]);
+        // permutevar8x32 only looks at the low 3 bits, so look up both halves of the table and pick one.
+        __m256 from_high = _mm256_castsi256_ps(_mm256_cmpgt_epi32(index, seven));
+        __m256 weight = _mm256_blendv_ps(_mm256_permutevar8x32_ps(low, index),
+                                         _mm256_permutevar8x32_ps(high, index), from_high);
+        _mm256_storeu_ps(&control[i], _mm256_add_ps(_mm256_loadu_ps(&control[i]), weight));
+    }
+}
+
+WALLGO_AVX2 float control_share(const std::array<float, 64>& mine, const std::array<float, 64>& theirs,
+                                float epsilon) {
+    const __m256 eps = _mm256_set1_ps(epsilon);
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < 64; i += 8) {
+        __m256 m = _mm256_loadu_ps(&mine[i]);
+        __m256 t = _mm256_loadu_ps(&theirs[i]);
+        acc = _mm256_add_ps(acc, _mm256_div_ps(_mm256_sub_ps(m, t), _mm256_add_ps(_mm256_add_ps(m, t), eps)));
+    }
+    return horizontal_sum(acc);
+}
+
+}  // namespace avx2
+
+#endif  // WALLGO_X86
+
+struct Implementation {
+    const char* name;
+    int (*voronoi)(const PaddedField&, const PaddedField&);
+    float (*ratio)(const PaddedField&, const PaddedField&);
+    float (*pair_table)(const PaddedField&, const PaddedField&, const PairTable&);
+    void (*add_decay)(const PaddedField&, const DecayTable&, std::array<float, 64>&);
+    float (*control_share)(const std::array<float, 64>&, const std::array<float, 64>&, float);
+};
+
+Implementation choose() {
+#ifdef WALLGO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", avx2::voronoi, avx2::ratio, avx2::pair_table, avx2::add_decay, avx2::control_share};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        // SSE2 has no variable shuffle of floats or gather, so the table lookups stay scalar.
+        return {"sse2", sse2::voronoi, sse2::ratio, scalar::pair_table, scalar::add_decay, sse2::control_share};
+    }
+#endif
+    return {"scalar", scalar::voronoi, scalar::ratio, scalar::pair_table, scalar::add_decay, scalar::control_share};
+}
+
+const Implementation& implementation() {
+    static const Implementation chosen = choose();
+    return chosen;
+}
+
+}  // namespace
+
+PaddedField pad(const DistanceField& field) {
+    PaddedField padded;
+    padded.d.fill(UNREACHABLE);
+    for (int i = 0; i < 49; ++i) {
+        padded.d[i] = static_cast<uint8_t>(std::min(field[i], UNREACHABLE));
+    }
+    return padded;
+}
+
+DecayTable DecayTable::exponential(double rate) {
+    DecayTable table;
+    for (int d = 0; d < 15; ++d) {
+        table.w[d] = static_cast<float>(std::exp(-rate * d));
+    }
+    table.w[15] = 0;
+    return table;
+}
+
+const char* isa() { return implementation().name; }
+
+int voronoi(const PaddedField& mine, const PaddedField& theirs) { return implementation().voronoi(mine, theirs); }
+
+float ratio(const PaddedField& mine, const PaddedField& theirs) { return implementation().ratio(mine, theirs); }
+
+float pair_table(const PaddedField& mine, const PaddedField& theirs, const PairTable& table) {
+    // The 15 padding lanes look up the (UNREACHABLE, UNREACHABLE) entry.
+    return implementation().pair_table(mine, theirs, table) - 15 * table.score[255];
+}
+
+void add_decay(const PaddedField& field, const DecayTable& table, std::array<float, 64>& control) {
+    implementation().add_decay(field, table, control);
+    std::fill(control.begin() + 49, control.end(), 0.0f);
+}
+
+float control_share(const std::array<float, 64>& mine, const std::array<float, 64>& theirs, float epsilon) {
+    // Padding lanes have zero control on both sides, so they add nothing as long as epsilon is positive.
+    return implementation().control_share(mine, theirs, epsilon);
+}
+
+}  // namespace kernels
+}  // namespace wallgo
@@ -0,0 +1,65 @@
+#ifndef WALLGO_EVAL_KERNELS_H
+#define WALLGO_EVAL_KERNELS_H
+
+#include <array>
+#include <cstdint>
+
+#include "evaluation.h"
+
+namespace wallgo {
+
+// Branch-free per-cell evaluation kernels over distance fields. Each field is padded from 49 to 64 one-byte lanes so
+// that it fills whole SIMD registers; padding lanes are UNREACHABLE for both sides and contribute nothing.
+//
+// The widest instruction set the CPU supports is picked at startup: AVX2, then SSE2, then plain C++. All versions
+// give the same results up to float rounding.
+namespace kernels {
+
+struct alignas(32) PaddedField {
+    std::array<uint8_t, 64> d;
+};
+
+// Converts a distance field to its padded form.
+PaddedField pad(const DistanceField& field);
+
+// Table lookups clamp distances to 14 and map UNREACHABLE to 15, so that every distance fits in 4 bits.
+
+// Weight of a cell at each distance from a piece.
+struct alignas(32) DecayTable {
+    std::array<float, 16> w;
+
+    // w[d] = exp(-rate * d) for d < 15, and w[15] = 0 for unreachable cells.
+    static DecayTable exponential(double rate);
+};
+
+// Score of a pair of distances (mine, theirs).
+struct alignas(32) PairTable {
+    std::array<float, 256> score;  // Indexed mine * 16 + theirs
+
+    float& at(int mine, int theirs) { return score[mine * 16 + theirs]; }
+};
+
+// Name of the instruction set in use: "avx2", "sse2" or "scalar".
+const char* isa();
+
+// Voronoi ownership: cells strictly closer to mine minus cells strictly closer to theirs.
+int voronoi(const PaddedField& mine, const PaddedField& theirs);
+
+// Distance-ratio control: a cell reachable by both sides scores (theirs - mine) / (mine + theirs), a cell reachable
+// by one side scores +1 or -1, and a cell reachable by neither scores 0.
+float ratio(const PaddedField& mine, const PaddedField& theirs);
+
+// Sums table[mine][theirs] over all cells.
+float pair_table(const PaddedField& mine, const PaddedField& theirs, const PairTable& table);
+
+// Adds the decay weight of every cell's distance in field to control.
+void add_decay(const PaddedField& field, const DecayTable& table, std::array<float, 64>& control);
+
+// Control share: sums (mine - theirs) / (mine + theirs + epsilon) over all cells.
+float control_share(const std::array<float, 64>& mine, const std::array<float, 64>& theirs, float epsilon);
+
+}  // namespace kernels
+
+}  // namespace wallgo
+
+#endif  // WALLGO_EVAL_KERNELS_H
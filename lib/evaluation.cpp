@@ -0,0 +1,409 @@
+#include "evaluation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include "eval_kernels.h"
+#include "inference.h"
+#include "instrumentation.h"
+#include "nnue.h"
+
+namespace wallgo {
+
+namespace {
+
+class TerritoryEvaluator : public Evaluator {
+   public:
+    double evaluate(const Board& board, PlayerColor player) override {
+        WALLGO_COUNT(evaluations, 1);
+        WALLGO_PHASE(eval_seconds);
+        auto territory = board.get_territory();
+        double diff = territory.red_total - territory.blue_total;
+        return player == PlayerColor::Red ? diff : -diff;
+    }
+};
+
+class VoronoiEvaluator : public FieldEvaluator {
+   protected:
+    double score(const kernels::PaddedField& mine, const kernels::PaddedField& theirs) override {
+        return kernels::voronoi(mine, theirs);
+    }
+
+   public:
+    VoronoiEvaluator() : FieldEvaluator(false) {}
+};
+
+class RatioEvaluator : public FieldEvaluator {
+   protected:
+    double score(const kernels::PaddedField& mine, const kernels::PaddedField& theirs) override {
+        return kernels::ratio(mine, theirs);
+    }
+
+   public:
+    RatioEvaluator() : FieldEvaluator(true) {}
+};
+
+// The lookup of the ethen trainer, with its guaranteed and semi-guaranteed scores made symmetric between colors.
+class EthenEvaluator : public FieldEvaluator {
+   private:
+    static constexpr int CONSIDER_BOUNDARY = 6;
+
+    static double lookup_score(int mine, int theirs) {
+        if (mine == theirs) return 0.0;
+        if (theirs == UNREACHABLE || mine == 0) return 0.9;
+        if (mine == UNREACHABLE || theirs == 0) return -0.9;
+        if (mine >= CONSIDER_BOUNDARY && theirs >= CONSIDER_BOUNDARY) return 0.0;
+        if (mine >= CONSIDER_BOUNDARY) return -0.8;
+        if (theirs >= CONSIDER_BOUNDARY) return 0.8;
+        return (theirs - mine) / static_cast<double>(std::max(mine, theirs)) * 0.9;
+    }
+
+    static kernels::PairTable make_table() {
+        kernels::PairTable table;
+        for (int mine = 0; mine < 16; ++mine) {
+            for (int theirs = 0; theirs < 16; ++theirs) {
+                table.at(mine, theirs) =
+                    lookup_score(mine == 15 ? UNREACHABLE : mine, theirs == 15 ? UNREACHABLE : theirs);
+            }
+        }
+        return table;
+    }
+
+   protected:
+    double score(const kernels::PaddedField& mine, const kernels::PaddedField& theirs) override {
+        static const kernels::PairTable table = make_table();
+        return kernels::pair_table(mine, theirs, table);
+    }
+
+   public:
+    EthenEvaluator() : FieldEvaluator(false) {}
+};
+
+// Scores cells by a pair table loaded from a file.
+class TableEvaluator : public FieldEvaluator {
+   private:
+    kernels::PairTable table_;
+
+   protected:
+    double score(const kernels::PaddedField& mine, const kernels::PaddedField& theirs) override {
+        return kernels::pair_table(mine, theirs, table_);
+    }
+
+   public:
+    explicit TableEvaluator(const kernels::PairTable& table) : FieldEvaluator(false), table_(table) {}
+};
+
+// Exponentially decaying control of every piece, as in old-impl, compared as each side's share of the total.
+class DecayEvaluator : public Evaluator {
+   public:
+    double evaluate(const Board& board, PlayerColor player) override {
+        static const kernels::DecayTable table = kernels::DecayTable::exponential(1.0);
+        WALLGO_COUNT(evaluations, 1);
+        std::array<float, 64> mine = {}, theirs = {};
+        for (PlayerColor color : {player, opponent_of(player)}) {
+            for (const Piece& piece : board.get_pieces(color)) {
+                kernels::PaddedField field = kernels::pad(piece_distance_field(board, piece.pos));
+                WALLGO_PHASE(eval_seconds);
+                kernels::add_decay(field, table, color == player ? mine : theirs);
+            }
+        }
+        WALLGO_PHASE(eval_seconds);
+        return kernels::control_share(mine, theirs, 1e-5f);
+    }
+};
+
+// Scores positions with an efficiently updatable network. Children are scored by updating a copy of the parent's
+// accumulators with the three features each move changes.
+class NetworkEvaluator : public Evaluator {
+   private:
+    nnue::Network network_;
+
+   public:
+    explicit NetworkEvaluator(nnue::Network network) : network_(std::move(network)) {}
+
+    double evaluate(const Board& board, PlayerColor player) override {
+        WALLGO_COUNT(evaluations, 1);
+        WALLGO_PHASE(eval_seconds);
+        nnue::Accumulator accumulator;
+        network_.refresh(board, accumulator);
+        return network_.evaluate(accumulator, player);
+    }
+
+    std::vector<double> evaluate_children(const Board& parent, const std::vector<Move>& moves,
+                                          PlayerColor player) override {
+        WALLGO_COUNT(evaluations, moves.size());
+        WALLGO_PHASE(eval_seconds);
+        nnue::Accumulator accumulator;
+        network_.refresh(parent, accumulator);
+        std::vector<double> scores;
+        scores.reserve(moves.size());
+        for (const Move& move : moves) {
+            network_.apply(parent, move, accumulator);
+            scores.push_back(network_.evaluate(accumulator, player));
+            network_.undo(parent, move, accumulator);
+        }
+        return scores;
+    }
+};
+
+// Scores positions with a batched dense network. All children of a node are evaluated as one batch.
+class BatchEvaluator : public Evaluator {
+   private:
+    inference::Model model_;
+    inference::Batch batch_;
+
+   public:
+    explicit BatchEvaluator(inference::Model model) : model_(std::move(model)) {}
+
+    double evaluate(const Board& board, PlayerColor player) override {
+        WALLGO_COUNT(evaluations, 1);
+        WALLGO_PHASE(eval_seconds);
+        batch_.clear();
+        batch_.add(inference::encode(board, player));
+        return model_.evaluate(batch_)[0];
+    }
+
+    std::vector<double> evaluate_children(const Board& parent, const std::vector<Move>& moves,
+                                          PlayerColor player) override {
+        WALLGO_COUNT(evaluations, moves.size());
+        WALLGO_PHASE(eval_seconds);
+        batch_.clear();
+        for (const Move& move : moves) {
+            batch_.add(inference::encode(parent.apply_move(move), player));
+        }
+        return model_.evaluate(batch_);
+    }
+};
+
+}  // namespace
+
+namespace {
+
+DistanceField bfs(const Board& board, const std::vector<Position>& sources, PlayerColor player,
+                  bool blocked_by_opponent) {
+    WALLGO_PHASE(bfs_seconds);
+    DistanceField dist;
+    dist.fill(UNREACHABLE);
+
+    std::array<Position, 49> queue;
+    int head = 0, tail = 0;
+    for (Position pos : sources) {
+        dist[pos.r * 7 + pos.c] = 0;
+        queue[tail++] = pos;
+    }
+    while (head < tail) {
+        Position pos = queue[head++];
+        for (const Cell& neighbor : board.get_accessible_neighbors(pos)) {
+            Position next = neighbor.pos();
+            int& d = dist[next.r * 7 + next.c];
+            if (d != UNREACHABLE) continue;
+            if (blocked_by_opponent && neighbor.piece() && neighbor.piece()->owner != player) continue;
+            d = dist[pos.r * 7 + pos.c] + 1;
+            queue[tail++] = next;
+        }
+    }
+    return dist;
+}
+
+// Offsets of the neighbouring cell index in each direction.
+constexpr int STEP[4] = {-7, 7, -1, 1};
+
+// The parts of a board that distance fields depend on, laid out for fast BFS.
+struct CompactBoard {
+    std::array<uint8_t, 49> walls;              // Bit d set if side d of the cell is blocked, including the border
+    std::array<uint8_t, 49> owner;              // 0 for empty, otherwise the PlayerColor of the piece
+    std::array<std::array<int, 4>, 3> cell_of;  // Cell of each piece by color and id, -1 if not on the board
+
+    explicit CompactBoard(const Board& board) {
+        for (auto& cells : cell_of) cells.fill(-1);
+        for (int r = 0; r < 7; ++r) {
+            for (int c = 0; c < 7; ++c) {
+                Cell cell = board.get({r, c});
+                int i = r * 7 + c;
+                walls[i] = (r == 0) | (r == 6) << 1 | (c == 0) << 2 | (c == 6) << 3;
+                for (int d = 0; d < 4; ++d) {
+                    if (cell.wall(static_cast<Direction>(d)) != WallType::None) walls[i] |= 1 << d;
+                }
+                owner[i] = cell.piece() ? static_cast<int>(cell.piece()->owner) : 0;
+                if (cell.piece()) cell_of[owner[i]][cell.piece()->id] = i;
+            }
+        }
+    }
+};
+
+void compact_bfs(const CompactBoard& board, int color, bool blocked_by_opponent, kernels::PaddedField& dist) {
+    WALLGO_PHASE(bfs_seconds);
+    dist.d.fill(UNREACHABLE);
+    std::array<uint8_t, 49> queue;
+    int head = 0, tail = 0;
+    for (int cell : board.cell_of[color]) {
+        if (cell < 0) continue;
+        dist.d[cell] = 0;
+        queue[tail++] = cell;
+    }
+    while (head < tail) {
+        int cell = queue[head++];
+        uint8_t next_dist = dist.d[cell] + 1;
+        for (int d = 0; d < 4; ++d) {
+            if (board.walls[cell] >> d & 1) continue;
+            int next = cell + STEP[d];
+            if (dist.d[next] != UNREACHABLE) continue;
+            if (blocked_by_opponent && board.owner[next] != 0 && board.owner[next] != color) continue;
+            dist.d[next] = next_dist;
+            queue[tail++] = next;
+        }
+    }
+}
+
+// Returns whether the wall just added between cells a and b changes dist, which was computed without it. The wall
+// only matters if the edge was on a shortest path, and then only if the farther cell has no other neighbour one step
+// closer: otherwise that cell keeps its distance and every path through the edge can be rerouted through it.
+bool wall_changes_field(const CompactBoard& board, const kernels::PaddedField& dist, int a, int b) {
+    if (std::abs(dist.d[a] - dist.d[b]) != 1) return false;
+    int far = dist.d[a] > dist.d[b] ? a : b;
+    for (int d = 0; d < 4; ++d) {
+        if (!(board.walls[far] >> d & 1) && dist.d[far + STEP[d]] + 1 == dist.d[far]) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::vector<double> Evaluator::evaluate_children(const Board& parent, const std::vector<Move>& moves,
+                                                 PlayerColor player) {
+    std::vector<double> scores;
+    scores.reserve(moves.size());
+    for (const Move& move : moves) {
+        scores.push_back(evaluate(parent.apply_move(move), player));
+    }
+    return scores;
+}
+
+FieldEvaluator::FieldEvaluator(bool blocked_by_opponent) : blocked_by_opponent_(blocked_by_opponent) {}
+
+double FieldEvaluator::evaluate(const Board& board, PlayerColor player) {
+    CompactBoard compact(board);
+    kernels::PaddedField fields[3];
+    compact_bfs(compact, 1, blocked_by_opponent_, fields[1]);
+    compact_bfs(compact, 2, blocked_by_opponent_, fields[2]);
+    int me = static_cast<int>(player);
+    WALLGO_COUNT(evaluations, 1);
+    WALLGO_PHASE(eval_seconds);
+    return score(fields[me], fields[3 - me]);
+}
+
+std::vector<double> FieldEvaluator::evaluate_children(const Board& parent, const std::vector<Move>& moves,
+                                                      PlayerColor player) {
+    CompactBoard board(parent);
+    kernels::PaddedField parent_fields[3], child_fields[3];
+    compact_bfs(board, 1, blocked_by_opponent_, parent_fields[1]);
+    compact_bfs(board, 2, blocked_by_opponent_, parent_fields[2]);
+
+    int me = static_cast<int>(player);
+    WALLGO_COUNT(nodes, moves.size());
+    WALLGO_COUNT(evaluations, moves.size());
+    std::vector<double> scores;
+    scores.reserve(moves.size());
+    for (const Move& move : moves) {
+        int color = static_cast<int>(move.player());
+        int from = board.cell_of[color][move.piece_id()];
+        int to = from;
+        if (move.direction1()) to += STEP[static_cast<int>(*move.direction1())];
+        if (move.direction2()) to += STEP[static_cast<int>(*move.direction2())];
+        int wall = static_cast<int>(move.wall_placement_direction());
+        int across = to + STEP[wall];
+        bool moved = to != from;
+
+        // Apply the move in place.
+        uint8_t old_to_walls = board.walls[to], old_across_walls = board.walls[across];
+        board.owner[from] = 0;
+        board.owner[to] = color;
+        board.cell_of[color][move.piece_id()] = to;
+        board.walls[to] |= 1 << wall;
+        board.walls[across] |= 1 << (wall ^ 1);
+
+        const kernels::PaddedField* fields[3];
+        for (int c = 1; c <= 2; ++c) {
+            // The mover's field changes with its sources; the other field only changes through the pieces blocking it.
+            bool changed = (moved && (c == color || blocked_by_opponent_)) ||
+                           wall_changes_field(board, parent_fields[c], to, across);
+            if (changed) {
+                compact_bfs(board, c, blocked_by_opponent_, child_fields[c]);
+                fields[c] = &child_fields[c];
+            } else {
+                fields[c] = &parent_fields[c];
+            }
+        }
+        {
+            WALLGO_PHASE(eval_seconds);
+            scores.push_back(score(*fields[me], *fields[3 - me]));
+        }
+
+        // Undo it.
+        board.walls[to] = old_to_walls;
+        board.walls[across] = old_across_walls;
+        board.cell_of[color][move.piece_id()] = from;
+        board.owner[to] = 0;
+        board.owner[from] = color;
+    }
+    return scores;
+}
+
+DistanceField distance_field(const Board& board, PlayerColor player, bool blocked_by_opponent) {
+    std::vector<Position> sources;
+    for (const Piece& piece : board.get_pieces(player)) {
+        sources.push_back(piece.pos);
+    }
+    return bfs(board, sources, player, blocked_by_opponent);
+}
+
+DistanceField piece_distance_field(const Board& board, Position pos) {
+    return bfs(board, {pos}, PlayerColor::Red, false);
+}
+
+kernels::PairTable read_pair_table(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    std::string magic;
+    int version;
+    if (!(in >> magic >> version) || magic != "wallgo-pair-table" || version != 1) {
+        throw std::runtime_error(path + " is not a pair table");
+    }
+    kernels::PairTable table;
+    for (float& score : table.score) {
+        if (!(in >> score)) throw std::runtime_error(path + " is truncated");
+    }
+    return table;
+}
+
+void write_pair_table(const std::string& path, const kernels::PairTable& table) {
+    std::ofstream out(path);
+    out.precision(9);
+    out << "wallgo-pair-table 1\n";
+    for (int mine = 0; mine < 16; ++mine) {
+        for (int theirs = 0; theirs < 16; ++theirs) {
+            out << (theirs ? " " : "") << table.score[mine * 16 + theirs];
+        }
+        out << "\n";
+    }
+    if (!out.flush()) throw std::runtime_error("Cannot write " + path);
+}
+
+std::vector<std::string> evaluator_names() { return {"territory", "voronoi", "ratio", "ethen", "decay"}; }
+
+std::unique_ptr<Evaluator> make_evaluator(const std::string& name) {
+    if (name == "territory") return std::make_unique<TerritoryEvaluator>();
+    if (name == "voronoi") return std::make_unique<VoronoiEvaluator>();
+    if (name == "ratio") return std::make_unique<RatioEvaluator>();
+    if (name == "ethen") return std::make_unique<EthenEvaluator>();
+    if (name == "decay") return std::make_unique<DecayEvaluator>();
+    if (name.rfind("table:", 0) == 0) return std::make_unique<TableEvaluator>(read_pair_table(name.substr(6)));
+    if (name.rfind("mlp:", 0) == 0) return std::make_unique<BatchEvaluator>(inference::Model::load(name.substr(4)));
+    if (name.rfind("nnue:", 0) == 0) return std::make_unique<NetworkEvaluator>(nnue::Network::load(name.substr(5)));
+    throw std::invalid_argument("Unknown evaluator " + name);
+}
+
+}  // namespace wallgo
@@ -0,0 +1,92 @@
+#ifndef WALLGO_EVALUATION_H
+#define WALLGO_EVALUATION_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+// Distance from the nearest piece of one color to every cell, indexed r * 7 + c.
+using DistanceField = std::array<int, 49>;
+
+// Distance of cells that no piece of the color can reach.
+constexpr int UNREACHABLE = 100;
+
+// Computes the distance field of player's pieces with a multi-source BFS over accessible neighbors. If
+// blocked_by_opponent is set, cells holding opponent pieces are not entered.
+DistanceField distance_field(const Board& board, PlayerColor player, bool blocked_by_opponent = false);
+
+// Computes the distance field of the single piece at pos.
+DistanceField piece_distance_field(const Board& board, Position pos);
+
+namespace kernels {
+struct PaddedField;
+struct PairTable;
+}  // namespace kernels
+
+// Reads and writes pair tables (see kernels::PairTable) as text: a "wallgo-pair-table 1" line, then 16 rows of 16
+// scores indexed [mine][theirs]. read_pair_table throws std::runtime_error if the file is missing or malformed.
+kernels::PairTable read_pair_table(const std::string& path);
+void write_pair_table(const std::string& path, const kernels::PairTable& table);
+
+// Scores positions for search and analysis.
+class Evaluator {
+   public:
+    // Returns the score of the board from player's point of view; higher is better for player. Scores are roughly in
+    // units of cells, and evaluate(board, Red) == -evaluate(board, Blue).
+    virtual double evaluate(const Board& board, PlayerColor player) = 0;
+
+    // Returns evaluate(parent.apply_move(move), player) for every move, in order. The moves must be legal on parent.
+    // The default applies and evaluates each move in turn; evaluators that can share work between siblings override
+    // it.
+    virtual std::vector<double> evaluate_children(const Board& parent, const std::vector<Move>& moves,
+                                                  PlayerColor player);
+
+    virtual ~Evaluator() = default;
+};
+
+// Base for evaluators that only look at the distance fields of both colors.
+//
+// Children are scored on a compact copy of the parent that each move is applied to and undone on, with one set of
+// scratch fields. A child differs from its parent by one piece and one wall, and a wall only changes a field if it
+// cuts an edge on a shortest path, so most fields of the color that did not move are reused from the parent instead
+// of being recomputed.
+class FieldEvaluator : public Evaluator {
+   private:
+    bool blocked_by_opponent_;
+
+   protected:
+    // If blocked_by_opponent is set, the fields do not enter cells holding opponent pieces, see distance_field.
+    explicit FieldEvaluator(bool blocked_by_opponent);
+
+    // Scores the padded distance fields of player (mine) and of the opponent (theirs).
+    virtual double score(const kernels::PaddedField& mine, const kernels::PaddedField& theirs) = 0;
+
+   public:
+    double evaluate(const Board& board, PlayerColor player) override;
+    std::vector<double> evaluate_children(const Board& parent, const std::vector<Move>& moves,
+                                          PlayerColor player) override;
+};
+
+// Names of the evaluators make_evaluator knows about.
+std::vector<std::string> evaluator_names();
+
+// Creates an evaluator by name:
+//   territory  difference in sealed territory, as counted by Board::get_territory
+//   voronoi    cells strictly closer to one color than to the other
+//   ratio      cells weighted by distance ratio, as in the wjx trainer
+//   ethen      cells scored by the distance lookup of the ethen trainer
+//   decay      each side's share of exp(-distance) control summed over pieces, as in old-impl
+//   table:<file>  cells scored by a pair table read with read_pair_table, e.g. one fitted by texel.exe
+//   nnue:<file>   an efficiently updatable network read with nnue::Network::load
+//   mlp:<file>    a dense network over board planes read with inference::Model::load, scoring children in one batch
+// Throws std::invalid_argument for unknown names, and std::runtime_error if a table or model cannot be read.
+std::unique_ptr<Evaluator> make_evaluator(const std::string& name);
+
+}  // namespace wallgo
+
+#endif  // WALLGO_EVALUATION_H
@@ -0,0 +1,191 @@
+#include "event_log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace wallgo {
+
+namespace {
+
+void append_json_string(const std::string& s, std::string& out) {
+    out += '"';
+    for (char ch : s) {
+        switch (ch) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                    out += escaped;
+                } else {
+                    out += ch;
+                }
+        }
+    }
+    out += '"';
+}
+
+template <typename T>
+void append_raw(T value, std::string& out) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+}  // namespace
+
+void encode_event(const Event& event, EventFormat format, std::string& out) {
+    int64_t ns = event.time.count();
+    switch (format) {
+        case EventFormat::Text: {
+            char time[32];
+            std::snprintf(time, sizeof(time), "%s%lld.%09lld", ns < 0 ? "-" : "",
+                          static_cast<long long>(std::abs(ns) / 1000000000),
+                          static_cast<long long>(std::abs(ns) % 1000000000));
+            out += 'P';
+            out += std::to_string(event.player);
+            out += '\t';
+            out += time;
+            out += "s\t";
+            out += event.message;
+            out += '\n';
+            break;
+        }
+        case EventFormat::Jsonl:
+            out += "{\"player\":";
+            out += std::to_string(event.player);
+            out += ",\"time_ns\":";
+            out += std::to_string(ns);
+            out += ",\"message\":";
+            append_json_string(event.message, out);
+            out += "}\n";
+            break;
+        case EventFormat::Binary:
+            append_raw(static_cast<uint8_t>(event.player), out);
+            append_raw(static_cast<int64_t>(ns), out);
+            append_raw(static_cast<uint32_t>(event.message.size()), out);
+            out += event.message;
+            break;
+    }
+}
+
+// StreamSink implementation
+
+StreamSink::StreamSink(std::ostream& out, EventFormat format) : out_(out), format_(format) {}
+
+void StreamSink::write(const Event& event) {
+    if (format_ == EventFormat::Text) {
+        std::chrono::duration<double> seconds = event.time;
+        out_ << "P" << event.player << "\t" << seconds.count() << "s\t" << event.message << "\n";
+        return;
+    }
+    scratch_.clear();
+    encode_event(event, format_, scratch_);
+    out_.write(scratch_.data(), scratch_.size());
+}
+
+void StreamSink::flush() { out_.flush(); }
+
+void StreamSink::format_message(std::ostream& message) const { message.copyfmt(out_); }
+
+// BufferedSink implementation
+
+BufferedSink::BufferedSink(std::ostream& out, EventFormat format) : out_(out), format_(format) {}
+
+BufferedSink::~BufferedSink() { flush(); }
+
+void BufferedSink::write(const Event& event) { encode_event(event, format_, buffer_); }
+
+void BufferedSink::flush() {
+    if (buffer_.empty()) return;
+    out_.write(buffer_.data(), buffer_.size());
+    out_.flush();
+    buffer_.clear();
+}
+
+void BufferedSink::format_message(std::ostream& message) const { message.copyfmt(out_); }
+
+// AsyncWriter implementation
+
+AsyncWriter::AsyncWriter(std::ostream& out) : out_(out) {
+    message_format_.copyfmt(out);
+    thread_ = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    stopping_.store(true, std::memory_order_release);
+    // Wake the thread with an empty chunk; it leaves once the list is drained.
+    submit(std::string());
+    thread_.join();
+}
+
+void AsyncWriter::submit(std::string data) {
+    Chunk* chunk = new Chunk{std::move(data), head_.load(std::memory_order_relaxed)};
+    while (!head_.compare_exchange_weak(chunk->next, chunk, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    head_.notify_one();
+}
+
+void AsyncWriter::run() {
+    while (true) {
+        Chunk* list = head_.exchange(nullptr, std::memory_order_acquire);
+        if (!list) {
+            if (stopping_.load(std::memory_order_acquire)) break;
+            head_.wait(nullptr, std::memory_order_acquire);
+            continue;
+        }
+
+        // The list is newest first.
+        Chunk* ordered = nullptr;
+        while (list) {
+            Chunk* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+        while (ordered) {
+            out_.write(ordered->data.data(), ordered->data.size());
+            Chunk* next = ordered->next;
+            delete ordered;
+            ordered = next;
+        }
+        out_.flush();
+    }
+}
+
+void AsyncWriter::format_message(std::ostream& message) const { message.copyfmt(message_format_); }
+
+// AsyncSink implementation
+
+AsyncSink::AsyncSink(AsyncWriter& writer, EventFormat format, size_t chunk_size)
+    : writer_(writer), format_(format), chunk_size_(chunk_size) {}
+
+AsyncSink::~AsyncSink() { flush(); }
+
+void AsyncSink::write(const Event& event) {
+    encode_event(event, format_, buffer_);
+    if (buffer_.size() >= chunk_size_) flush();
+}
+
+void AsyncSink::flush() {
+    if (buffer_.empty()) return;
+    writer_.submit(std::move(buffer_));
+    buffer_.clear();
+}
+
+void AsyncSink::format_message(std::ostream& message) const { writer_.format_message(message); }
+
+}  // namespace wallgo
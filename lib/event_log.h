@@ -0,0 +1,147 @@
+#ifndef WALLGO_EVENT_LOG_H
+#define WALLGO_EVENT_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace wallgo {
+
+// An entry of the game controller's event log.
+struct Event {
+    int player;                 // 0 for the controller itself
+    std::chrono::nanoseconds time;  // Since the start of the game, as measured by the controller
+    std::string message;
+};
+
+enum class EventFormat {
+    // "P<player>\t<seconds>s\t<message>\n", as the controller always logged.
+    Text,
+    // {"player":<player>,"time_ns":<nanoseconds>,"message":"<message>"}
+    Jsonl,
+    // Fixed header followed by the message bytes: uint8 player, int64 nanoseconds, uint32 message length, all in
+    // host byte order and without padding.
+    Binary
+};
+
+// Appends the encoding of event to out. Text times are written with nanosecond precision.
+void encode_event(const Event& event, EventFormat format, std::string& out);
+
+// Destination of the events of one game.
+class EventSink {
+   public:
+    // Records an event. Sinks may hold events back until flush.
+    virtual void write(const Event& event) = 0;
+
+    // Pushes out all events written so far. The controller calls this when the game ends.
+    virtual void flush() {}
+
+    // Sets up the stream that the controller formats event messages with, e.g. its precision.
+    virtual void format_message(std::ostream& message) const {}
+
+    virtual ~EventSink() = default;
+};
+
+// Discards all events, e.g. for tournaments that only need the outcome.
+class NullSink : public EventSink {
+   public:
+    void write(const Event& event) override {}
+};
+
+// A stream buffer that discards everything written to it, e.g. to silence std::cout while strategies play.
+class NullBuffer : public std::streambuf {
+   protected:
+    int overflow(int ch) override { return ch; }
+    std::streamsize xsputn(const char* s, std::streamsize n) override { return n; }
+};
+
+// Writes every event straight to a stream, without flushing it per event. Text events use the stream's own number
+// formatting, as the controller always did.
+class StreamSink : public EventSink {
+   private:
+    std::ostream& out_;
+    EventFormat format_;
+    std::string scratch_;
+
+   public:
+    explicit StreamSink(std::ostream& out, EventFormat format = EventFormat::Text);
+    void write(const Event& event) override;
+    void flush() override;
+    void format_message(std::ostream& message) const override;
+};
+
+// Keeps the events of a game in memory and writes them to a stream in one piece on flush, so that games running in
+// parallel on the same stream do not interleave.
+class BufferedSink : public EventSink {
+   private:
+    std::ostream& out_;
+    EventFormat format_;
+    std::string buffer_;
+
+   public:
+    explicit BufferedSink(std::ostream& out, EventFormat format = EventFormat::Text);
+    ~BufferedSink() override;
+    void write(const Event& event) override;
+    void flush() override;
+    void format_message(std::ostream& message) const override;
+};
+
+// Background thread that writes chunks of encoded events to a stream. Any number of threads can submit chunks; they
+// are handed over through a lock-free list, so submitting never waits for the stream. Chunks from one thread are
+// written in the order they were submitted.
+class AsyncWriter {
+   private:
+    struct Chunk {
+        std::string data;
+        Chunk* next;
+    };
+
+    std::ostream& out_;
+    std::ostringstream message_format_;
+    std::atomic<Chunk*> head_{nullptr};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+
+    void run();
+
+   public:
+    // out must not be used by anyone else until the writer is destroyed.
+    explicit AsyncWriter(std::ostream& out);
+
+    // Writes out everything submitted so far, then stops the thread.
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    void submit(std::string data);
+
+    // Copies the number formatting the stream had when the writer was created.
+    void format_message(std::ostream& message) const;
+};
+
+// Buffers the events of a game and hands them to an AsyncWriter on flush, or earlier once the buffer exceeds
+// chunk_size bytes.
+class AsyncSink : public EventSink {
+   private:
+    AsyncWriter& writer_;
+    EventFormat format_;
+    size_t chunk_size_;
+    std::string buffer_;
+
+   public:
+    AsyncSink(AsyncWriter& writer, EventFormat format = EventFormat::Text, size_t chunk_size = 1 << 16);
+    ~AsyncSink() override;
+    void write(const Event& event) override;
+    void flush() override;
+    void format_message(std::ostream& message) const override;
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_EVENT_LOG_H
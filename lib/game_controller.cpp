@@ -2,13 +2,16 @@
 
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "instrumentation.h"
 #include "types.h"
 
 namespace wallgo {
@@ -19,61 +22,234 @@ double GameController::getTimeSinceLastEvent() const {
     return diff.count();
 }
 
+TimeControl TimeControl::parse(const std::string& spec) {
+    TimeControl time_control;
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("Time control item without value: " + item);
+        }
+        std::string key = item.substr(0, eq);
+        std::stringstream value(item.substr(eq + 1));
+        bool ok;
+        if (key == "budget") {
+            ok = static_cast<bool>(value >> time_control.budget);
+        } else if (key == "inc") {
+            ok = static_cast<bool>(value >> time_control.increment);
+        } else if (key == "move") {
+            ok = static_cast<bool>(value >> time_control.move_time);
+        } else if (key == "grace") {
+            ok = static_cast<bool>(value >> time_control.grace);
+        } else if (key == "nodes") {
+            ok = static_cast<bool>(value >> time_control.nodes);
+        } else if (key == "backstop") {
+            ok = static_cast<bool>(value >> time_control.backstop);
+        } else if (key == "odds") {
+            char colon = 0;
+            ok = value >> time_control.odds[1] >> colon >> time_control.odds[2] && colon == ':';
+        } else {
+            throw std::invalid_argument("Unknown time control key: " + key);
+        }
+        if (!ok || !value.eof()) {
+            throw std::invalid_argument("Malformed time control value: " + item);
+        }
+    }
+    return time_control;
+}
+
 bool GameController::subtractTimeAndCheckTimeLimit(int player, double time) {
+    if (time_control_.nodes) {
+        // Nodes are only counted if the strategy is built with -DWALLGO_INSTRUMENT or reports them, so the clock
+        // still bounds every timed call.
+        if (time <= time_control_.backstop) return false;
+        addEvent(player) << "Took " << time << "s, over the node mode backstop of " << time_control_.backstop << "s!";
+        return true;
+    }
     playersRemainingTime_[player] -= time;
     if (playersRemainingTime_[player] < 0) {
-        addEvent(player) << "Ran out of time!" << std::endl;
+        addEvent(player) << "Ran out of time!";
         return true;
     }
     return false;
 }
 
-std::ostream& GameController::addEvent(int player) {
+GameController::EventLine::EventLine(EventSink& sink, int player, std::chrono::nanoseconds time)
+    : sink_(sink), event_{player, time, ""} {
+    sink_.format_message(message_);
+}
+
+GameController::EventLine::~EventLine() {
+    event_.message = message_.str();
+    sink_.write(event_);
+}
+
+GameController::EventLine GameController::addEvent(int player) {
+    last_time_ = std::chrono::steady_clock::now();
+    return EventLine(*events_, player, last_time_ - start_time_);
+}
+
+SearchLimits GameController::limitsFor(int player) const {
+    double odds = time_control_.odds[player];
+    return SearchLimits{
+        time_control_.move_time > 0 ? time_control_.move_time * odds : playersRemainingTime_[player],
+        time_control_.increment * odds, static_cast<uint64_t>(time_control_.nodes * odds)};
+}
+
+bool GameController::chargeDecision(int player, int ply, double time_used, const SearchStats& stats) {
+    bool out_of_time;
+    if (time_control_.nodes) {
+        // Nodes searched in init or callbacks since the last decision count against this one.
+        uint64_t budget = limitsFor(player).nodes;
+        uint64_t nodes = stats.nodes + callback_nodes_[player];
+        callback_nodes_[player] = 0;
+        out_of_time = nodes > budget;
+        if (out_of_time) {
+            addEvent(player) << "Searched " << nodes << " nodes, over the budget of " << budget << "!";
+        } else {
+            out_of_time = subtractTimeAndCheckTimeLimit(player, time_used);
+        }
+    } else {
+        if (time_control_.move_time > 0) {
+            playersRemainingTime_[player] = time_control_.move_time * time_control_.odds[player];
+        }
+        out_of_time = subtractTimeAndCheckTimeLimit(player, time_used - time_control_.grace);
+        if (!out_of_time) {
+            playersRemainingTime_[player] += time_control_.increment * time_control_.odds[player];
+        }
+    }
+    recordDecision(player, ply, time_used);
+    return out_of_time;
+}
+
+void GameController::recordDecision(int player, int ply, double time_used) {
+    PlayerTiming& timing = timing_[player];
+    (ply < 8 ? timing.placement_time : timing.movement_time) += time_used;
+    timing.decisions.push_back(DecisionTime{ply, time_used, playersRemainingTime_[player]});
+}
+
+// Ends the game with a loss for a player that gave up a decision, see Forfeit.
+GameOutcome GameController::forfeited(int player, int ply, double time_used, const Forfeit& forfeit) {
+    recordDecision(player, ply, time_used);
+    std::stringstream message;
+    message << "Player " << player << " forfeited: " << forfeit.what();
+    addEvent(player) << message.str();
+    return GameOutcome{static_cast<PlayerColor>(3 - player), forfeit.reason, games_[0]->encode(), message.str()};
+}
+
+SearchStats GameController::decisionStats(int player, SearchStats recorded) const {
+    if (const SearchStats* reported = players_[player]->search_stats()) {
+        recorded += *reported;
+    }
+    return recorded;
+}
+
+void GameController::addTrace(int player, int ply, const char* kind, double time_used, SearchStats stats) {
+    if (!trace_output_) return;
+    *trace_output_ << "{\"seed\":" << seed_ << ",\"ply\":" << ply << ",\"player\":" << player << ",\"kind\":\"" << kind
+                   << "\",\"time\":" << time_used << ",\"nodes\":" << stats.nodes
+                   << ",\"nps\":" << (time_used > 0 ? stats.nodes / time_used : 0) << ",\"depth\":" << stats.depth
+                   << ",\"expanded\":" << stats.expanded << ",\"branching\":"
+                   << (stats.expanded ? static_cast<double>(stats.children) / stats.expanded : 0)
+                   << ",\"evaluations\":" << stats.evaluations << ",\"tt_probes\":" << stats.tt_probes
+                   << ",\"tt_hit_rate\":"
+                   << (stats.tt_probes ? static_cast<double>(stats.tt_hits) / stats.tt_probes : 0)
+                   << ",\"movegen_s\":" << stats.movegen_seconds << ",\"bfs_s\":" << stats.bfs_seconds
+                   << ",\"eval_s\":" << stats.eval_seconds << "}\n";
+}
+
+// Passes an action to both players, charging each the time its callback takes and the nodes it searches, and returns
+// the first player that ran out of time, or 0. The clock of the next decision starts afterwards.
+int GameController::notifyPlayers(const std::function<void(Player&)>& notify) {
+    for (int player = 1; player <= 2; ++player) {
+        auto start = std::chrono::steady_clock::now();
+        SearchStats stats;
+        {
+            WALLGO_RECORD_SEARCH(stats);
+            notify(*players_[player]);
+        }
+        callback_nodes_[player] += stats.nodes;
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+        double used = players_[player]->charged_seconds().value_or(wall.count());
+        if (subtractTimeAndCheckTimeLimit(player, used)) return player;
+    }
     last_time_ = std::chrono::steady_clock::now();
-    std::chrono::duration<double> diff = last_time_ - start_time_;
-    return output_data_ << "P" << player << "\t" << diff.count() << "s\t";
+    return 0;
 }
 
 GameController::GameController(int seed, std::unique_ptr<Player> player1, std::unique_ptr<Player> player2,
-                               std::ostream& output_data)
-    : seed_(seed), output_data_(output_data), players_(3), games_(3), playersRemainingTime_(3, 1) {
+                               std::unique_ptr<EventSink> events, std::ostream* trace_output,
+                               const TimeControl& time_control)
+    : players_(3),
+      games_(3),
+      playersRemainingTime_{0, time_control.budget * time_control.odds[1], time_control.budget * time_control.odds[2]},
+      events_(std::move(events)),
+      trace_output_(trace_output),
+      time_control_(time_control),
+      seed_(seed) {
     games_[0] = std::shared_ptr<Game>(new Game());
     games_[1] = std::shared_ptr<Game>(new Game());
     games_[2] = std::shared_ptr<Game>(new Game());
 
-    addEvent(0) << "Initializing Game with seed " << seed << std::endl;
+    addEvent(0) << "Initializing Game with seed " << seed;
 
     start_time_ = std::chrono::steady_clock::now();
-    addEvent(1) << "Initializing Player 1 (Red)" << std::endl;
-    player1->init(PlayerColor::Red, games_[1], seed_);
-    double player1_initialize_time = getTimeSinceLastEvent();
+    addEvent(1) << "Initializing Player 1 (Red)";
+    SearchStats init_stats;
+    {
+        WALLGO_RECORD_SEARCH(init_stats);
+        player1->init(PlayerColor::Red, games_[1], seed_);
+    }
+    callback_nodes_[1] = init_stats.nodes;
+    double player1_initialize_time = player1->charged_seconds().value_or(getTimeSinceLastEvent());
+    timing_[1].init_time = player1_initialize_time;
     if (subtractTimeAndCheckTimeLimit(1, player1_initialize_time)) {
-        std::stringstream message;
-        message << "Player 1 ran out of time while initializing";
-        throw std::runtime_error(message.str());
+        throw InitTimeout(GameOutcome{PlayerColor::Blue, OPPONENT_TLE, games_[0]->encode(),
+                                      "Player 1 ran out of time while initializing", timing_});
     }
-    addEvent(1) << "Initializing Player 1 completed in " << player1_initialize_time << "s" << std::endl;
+    addEvent(1) << "Initializing Player 1 completed in " << player1_initialize_time << "s";
     player1.swap(players_[1]);
 
-    addEvent(2) << "Initializing Player 2 (Blue)" << std::endl;
-    player2->init(PlayerColor::Blue, games_[2], seed_);
-    double player2_initialize_time = getTimeSinceLastEvent();
+    addEvent(2) << "Initializing Player 2 (Blue)";
+    init_stats = SearchStats();
+    {
+        WALLGO_RECORD_SEARCH(init_stats);
+        player2->init(PlayerColor::Blue, games_[2], seed_);
+    }
+    callback_nodes_[2] = init_stats.nodes;
+    double player2_initialize_time = player2->charged_seconds().value_or(getTimeSinceLastEvent());
+    timing_[2].init_time = player2_initialize_time;
     if (subtractTimeAndCheckTimeLimit(2, player2_initialize_time)) {
-        std::stringstream message;
-        message << "Player 2 ran out of time while initializing";
-        throw std::runtime_error(message.str());
+        throw InitTimeout(GameOutcome{PlayerColor::Red, OPPONENT_TLE, games_[0]->encode(),
+                                      "Player 2 ran out of time while initializing", timing_});
     }
-    addEvent(2) << "Initializing Player 2 completed in " << player2_initialize_time << "s" << std::endl;
+    addEvent(2) << "Initializing Player 2 completed in " << player2_initialize_time << "s";
     player2.swap(players_[2]);
 }
 
+GameController::GameController(int seed, std::unique_ptr<Player> player1, std::unique_ptr<Player> player2,
+                               std::ostream& output_data, std::ostream* trace_output, const TimeControl& time_control)
+    : GameController(seed, std::move(player1), std::move(player2), std::make_unique<StreamSink>(output_data),
+                     trace_output, time_control) {}
+
 GameOutcome GameController::run() {
+    GameOutcome outcome = play();
+    outcome.timing = timing_;
+    for (int player = 1; player <= 2; ++player) {
+        players_[player]->on_game_over(outcome);
+    }
+    events_->flush();
+    return outcome;
+}
+
+GameOutcome GameController::play() {
     // place the pieces, in order RBBRRBBR
     for (int i = 0; i < 8; ++i) {
         std::vector<Position> valid_positions;
 
-        for (int r = 0; r < 7; ++r) {
-            for (int c = 0; c < 7; ++c) {
+        for (int r = 0; r < Board::SIZE; ++r) {
+            for (int c = 0; c < Board::SIZE; ++c) {
                 Position pos{r, c};
                 if (!games_[0]->board().get(pos).piece()) {
                     valid_positions.push_back(pos);
@@ -82,18 +258,31 @@ GameOutcome GameController::run() {
         }
 
         Position pos;
+        std::optional<Forfeit> forfeit;
         int current_player = (i == 0 || i == 3 || i == 4 || i == 7) ? 1 : 2;
         int current_piece_id = i / 2;
-        pos = players_[current_player]->place(current_piece_id, valid_positions);
-        double time_used = getTimeSinceLastEvent();
-        if (subtractTimeAndCheckTimeLimit(current_player, time_used - 0.1)) {
+        SearchStats stats;
+        players_[current_player]->set_limits(limitsFor(current_player));
+        {
+            WALLGO_RECORD_SEARCH(stats);
+            try {
+                pos = players_[current_player]->place(current_piece_id, valid_positions);
+            } catch (const Forfeit& e) {
+                forfeit = e;
+            }
+        }
+        double time_used = players_[current_player]->charged_seconds().value_or(getTimeSinceLastEvent());
+        stats = decisionStats(current_player, stats);
+        addTrace(current_player, i, "place", time_used, stats);
+        if (forfeit) return forfeited(current_player, i, time_used, *forfeit);
+        if (chargeDecision(current_player, i, time_used, stats)) {
             std::stringstream message;
             message << "Player " << current_player << " ran out of time while placing piece";
             return GameOutcome{static_cast<PlayerColor>(3 - current_player), OPPONENT_TLE, games_[0]->encode(),
                                message.str()};
         }
-        addEvent(current_player) << "Took " << time_used << "s to place piece." << std::endl;
-        addEvent(current_player) << "Placed piece at (" << pos.r << "," << pos.c << ")" << std::endl;
+        addEvent(current_player) << "Took " << time_used << "s to place piece.";
+        addEvent(current_player) << "Placed piece at (" << pos.r << "," << pos.c << ")";
 
         if (std::find(valid_positions.begin(), valid_positions.end(), pos) == valid_positions.end()) {
             std::stringstream message;
@@ -107,70 +296,86 @@ GameOutcome GameController::run() {
             // id is i/2
             games_[game]->place_piece(pos, static_cast<PlayerColor>(current_player), current_piece_id);
         }
+        Piece piece{static_cast<PlayerColor>(current_player), pos, current_piece_id};
+        if (int late = notifyPlayers([&](Player& player) { player.on_placement(piece); })) {
+            std::stringstream message;
+            message << "Player " << late << " ran out of time while following a placement";
+            return GameOutcome{static_cast<PlayerColor>(3 - late), OPPONENT_TLE, games_[0]->encode(), message.str()};
+        }
     }
 
     // move
     bool game_ended = false;
     int current_player = 1;
-    for (; !game_ended; current_player = 3 - current_player) {
+    for (int ply = 8; !game_ended; current_player = 3 - current_player, ++ply) {
         PlayerColor opponent_color = static_cast<PlayerColor>(3 - current_player);
 
         std::vector<Move>&& valid_moves =
             games_[0]->board().get_valid_moves(static_cast<PlayerColor>(current_player));  // note: won't be empty
 
-        Move move = players_[current_player]->move(valid_moves);
+        SearchStats stats;
+        std::optional<Move> chosen;
+        std::optional<Forfeit> forfeit;
+        players_[current_player]->set_limits(limitsFor(current_player));
+        {
+            WALLGO_RECORD_SEARCH(stats);
+            try {
+                chosen = players_[current_player]->move(valid_moves);
+            } catch (const Forfeit& e) {
+                forfeit = e;
+            }
+        }
+        double time_used = players_[current_player]->charged_seconds().value_or(getTimeSinceLastEvent());
+        stats = decisionStats(current_player, stats);
+        addTrace(current_player, ply, "move", time_used, stats);
+        if (forfeit) return forfeited(current_player, ply, time_used, *forfeit);
+        Move move = *chosen;
         if (move.player() != static_cast<PlayerColor>(current_player)) {
             return GameOutcome{opponent_color, OPPONENT_ILLEGAL_MOVE, games_[0]->encode(),
                                "Returned move does not have player set"};
         }
-        Piece piece = games_[0]->board().get_piece(move.player(), move.piece_id());
-        double time_used = getTimeSinceLastEvent();
-        if (subtractTimeAndCheckTimeLimit(current_player, time_used - 0.1)) {
+        if (chargeDecision(current_player, ply, time_used, stats)) {
             std::stringstream message;
             message << "Player " << current_player << " ran out of time while making a move";
             return GameOutcome{opponent_color, OPPONENT_TLE, games_[0]->encode(), message.str()};
         }
+        if (!games_[0]->board().is_move_legal(move)) {
+            std::stringstream message;
+            message << "Illegal move made by " << current_player;
+            return GameOutcome{opponent_color, OPPONENT_ILLEGAL_MOVE, games_[0]->encode(), message.str()};
+        }
+        Piece piece = games_[0]->board().get_piece(move.player(), move.piece_id());
         addEvent(current_player)
             << "Chose piece " << piece.id << " at (" << piece.pos.r << "," << piece.pos.c << "), "
             << "Number of steps: " << (move.direction1() ? 1 : 0) + (move.direction2() ? 1 : 0)
             << (move.direction1() ? ", Direction 1: " + std::to_string(static_cast<int>(*move.direction1())) : "")
             << (move.direction2() ? ", Direction 2: " + std::to_string(static_cast<int>(*move.direction2())) : "")
-            << ", Wall direction: " << static_cast<int>(move.wall_placement_direction()) << std::endl;
+            << ", Wall direction: " << static_cast<int>(move.wall_placement_direction());
 
-        if (!games_[0]->board().is_move_legal(move)) {
-            std::stringstream message;
-            message << "Illegal move made by " << current_player;
-            return GameOutcome{opponent_color, OPPONENT_ILLEGAL_MOVE, games_[0]->encode(), message.str()};
-        }
         for (int i = 0; i < 3; i++) {
             games_[i]->apply_move(move);
         }
+        if (int late = notifyPlayers([&](Player& player) { player.on_move(move); })) {
+            std::stringstream message;
+            message << "Player " << late << " ran out of time while following a move";
+            return GameOutcome{static_cast<PlayerColor>(3 - late), OPPONENT_TLE, games_[0]->encode(), message.str()};
+        }
         if (games_[0]->board().is_game_over()) {
-            addEvent(current_player) << "Ended the game and made the last move" << std::endl;
+            addEvent(current_player) << "Ended the game and made the last move";
             break;
         }
     }
     auto res = games_[0]->board().get_territory();
-    if (res.red_total != res.blue_total) {
-        std::stringstream message;
+    auto [winner, reason] = decide_winner(res, static_cast<PlayerColor>(current_player));
+    std::stringstream message;
+    if (reason == BY_TOTAL_AREA) {
         message << "Total territories: " << res.red_total << "-" << res.blue_total;
-        return GameOutcome{res.red_total > res.blue_total ? PlayerColor::Red : PlayerColor::Blue, BY_TOTAL_AREA,
-                           games_[0]->encode(), message.str()};
-    }
-
-    if (res.red_max != res.blue_max) {
-        std::stringstream message;
+    } else if (reason == BY_LARGEST_AREA) {
         message << res.red_max << "-" << res.blue_max;
-        return GameOutcome{res.red_max > res.blue_max ? PlayerColor::Red : PlayerColor::Blue, BY_LARGEST_AREA,
-                           games_[0]->encode(), message.str()};
-    }
-
-    if (current_player == 1) {
-        return GameOutcome{PlayerColor::Blue, BY_LAST_PLACEMENT, games_[0]->encode(),
-                           "Player 2 wins by last placement"};
     } else {
-        return GameOutcome{PlayerColor::Red, BY_LAST_PLACEMENT, games_[0]->encode(), "Player 1 wins by last placement"};
+        message << "Player " << static_cast<int>(winner) << " wins by last placement";
     }
+    return GameOutcome{winner, reason, games_[0]->encode(), message.str()};
 }
 
 }  // namespace wallgo
@@ -1,33 +1,105 @@
 #ifndef WALLGO_GAME_CONTROLLER_H
 #define WALLGO_GAME_CONTROLLER_H
 
+#include <array>
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "event_log.h"
 #include "types.h"
 
 namespace wallgo {
 
+// Time control of a game. With the defaults, each player has one second for the whole game including initialization,
+// and every decision is charged 0.1 seconds less than it took.
+struct TimeControl {
+    double budget = 1;                    // Seconds on each player's clock at the start
+    double increment = 0;                 // Seconds added to the clock after each decision
+    double move_time = 0;                 // If positive, the time of each decision; budget then only covers init
+    double grace = 0.1;                   // Seconds of each decision that are not charged
+    std::array<double, 3> odds{1, 1, 1};  // Factor on budget, increment, move_time and nodes, indexed by player number
+    uint64_t nodes = 0;                   // If nonzero, nodes per decision; the clock is then not charged
+    double backstop = 5;                  // With nodes, seconds any timed call may take before it loses on time
+
+    // Parses comma-separated key=value pairs, e.g. "budget=5,inc=0.05" or "nodes=20000,odds=1:0.5". Keys are budget,
+    // inc, move, grace, nodes, backstop and odds (factors of player 1 and player 2).
+    // Throws std::invalid_argument if malformed.
+    static TimeControl parse(const std::string& spec);
+};
+
+// Thrown by the GameController constructor if a player runs out of time while initializing. outcome is the game as
+// lost on time by that player before any piece is placed.
+class InitTimeout : public std::runtime_error {
+   public:
+    GameOutcome outcome;
+
+    explicit InitTimeout(GameOutcome outcome) : std::runtime_error(outcome.message), outcome(std::move(outcome)) {}
+};
+
 class GameController {
    private:
     std::vector<std::unique_ptr<Player>> players_;
     std::vector<std::shared_ptr<Game>> games_;
     std::vector<double> playersRemainingTime_;
-    std::ostream& output_data_;
+    std::array<PlayerTiming, 3> timing_;
+    std::array<uint64_t, 3> callback_nodes_{};  // Nodes each player searched outside decisions since its last one
+    std::unique_ptr<EventSink> events_;
+    std::ostream* trace_output_;
+    TimeControl time_control_;
     int seed_;
     std::chrono::time_point<std::chrono::steady_clock> start_time_;
     std::chrono::time_point<std::chrono::steady_clock> last_time_;
     std::chrono::steady_clock steady_clock_;
 
+    // Collects the message of one event and hands it to the sink when it goes out of scope.
+    class EventLine {
+       private:
+        EventSink& sink_;
+        Event event_;
+        std::ostringstream message_;
+
+       public:
+        EventLine(EventSink& sink, int player, std::chrono::nanoseconds time);
+        ~EventLine();
+
+        template <typename T>
+        EventLine& operator<<(const T& value) {
+            message_ << value;
+            return *this;
+        }
+    };
+
     double getTimeSinceLastEvent() const;
     bool subtractTimeAndCheckTimeLimit(int player, double time);
-    std::ostream& addEvent(int player);
+    EventLine addEvent(int player);
+    SearchLimits limitsFor(int player) const;
+    bool chargeDecision(int player, int ply, double time_used, const SearchStats& stats);
+    void recordDecision(int player, int ply, double time_used);
+    GameOutcome forfeited(int player, int ply, double time_used, const Forfeit& forfeit);
+    SearchStats decisionStats(int player, SearchStats recorded) const;
+    void addTrace(int player, int ply, const char* kind, double time_used, SearchStats stats);
+    int notifyPlayers(const std::function<void(Player&)>& notify);
+    GameOutcome play();
 
    public:
-    GameController(int seed, std::unique_ptr<Player> p1, std::unique_ptr<Player> p2, std::ostream& output_data);
+    // Events are logged to the sink, which is flushed when the game ends. If trace_output is given, every decision is
+    // also logged to it as a line of JSON with the time taken and the search statistics of the player.
+    //
+    // Under a node budget, a player loses on time if the nodes it reports, see SearchStats, exceed the budget, counting
+    // those recorded in init and callbacks since its last decision, or if init, a decision or a callback takes longer
+    // than the backstop.
+    GameController(int seed, std::unique_ptr<Player> p1, std::unique_ptr<Player> p2, std::unique_ptr<EventSink> events,
+                   std::ostream* trace_output = nullptr, const TimeControl& time_control = TimeControl());
+
+    // Events are logged as text to output_data.
+    GameController(int seed, std::unique_ptr<Player> p1, std::unique_ptr<Player> p2, std::ostream& output_data,
+                   std::ostream* trace_output = nullptr, const TimeControl& time_control = TimeControl());
     GameOutcome run();
 };
 
@@ -0,0 +1,335 @@
+#include "game_db.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+#include "zobrist.h"
+
+namespace wallgo {
+
+namespace {
+
+constexpr char MAGIC[8] = {'W', 'A', 'L', 'L', 'G', 'O', 'D', 'B'};
+
+// Placement order RBBRRBBR; piece i gets id i / 2.
+constexpr std::array<PlayerColor, 8> PLACEMENT_ORDER = {PlayerColor::Red,  PlayerColor::Blue, PlayerColor::Blue,
+                                                        PlayerColor::Red,  PlayerColor::Red,  PlayerColor::Blue,
+                                                        PlayerColor::Blue, PlayerColor::Red};
+
+PlayerColor player_to_act(size_t ply) {
+    if (ply < PLACEMENT_ORDER.size()) return PLACEMENT_ORDER[ply];
+    return (ply - PLACEMENT_ORDER.size()) % 2 == 0 ? PlayerColor::Red : PlayerColor::Blue;
+}
+
+// Step paths a piece can take: stay, one step, or two steps that do not come back to the start.
+struct Path {
+    std::optional<Direction> d1, d2;
+};
+
+constexpr int PATH_COUNT = 17;
+
+constexpr std::array<Path, PATH_COUNT> make_paths() {
+    std::array<Path, PATH_COUNT> paths{};
+    int n = 1;
+    for (int d1 = 0; d1 < 4; ++d1) {
+        paths[n++] = Path{static_cast<Direction>(d1), std::nullopt};
+    }
+    for (int d1 = 0; d1 < 4; ++d1) {
+        for (int d2 = 0; d2 < 4; ++d2) {
+            if (d2 == (d1 ^ 1)) continue;
+            paths[n++] = Path{static_cast<Direction>(d1), static_cast<Direction>(d2)};
+        }
+    }
+    return paths;
+}
+
+constexpr std::array<Path, PATH_COUNT> PATHS = make_paths();
+
+int path_index(std::optional<Direction> d1, std::optional<Direction> d2) {
+    for (int i = 0; i < PATH_COUNT; ++i) {
+        if (PATHS[i].d1 == d1 && PATHS[i].d2 == d2) return i;
+    }
+    throw std::runtime_error("Move path cannot be packed");
+}
+
+uint16_t read_bits(const uint8_t* data, uint64_t bit_offset, int bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < bits; ++i) {
+        uint64_t bit = bit_offset + i;
+        value |= ((data[bit >> 3] >> (bit & 7)) & 1u) << i;
+    }
+    return static_cast<uint16_t>(value);
+}
+
+}  // namespace
+
+uint16_t pack_move_9bit(const Move& move) {
+    int path = path_index(move.direction1(), move.direction2());
+    int wall = static_cast<int>(move.wall_placement_direction());
+    return static_cast<uint16_t>((move.piece_id() & 3) | ((path * 4 + wall) << 2));
+}
+
+Move unpack_move_9bit(uint16_t code, PlayerColor player) {
+    int path = (code >> 2) / 4;
+    if (path >= PATH_COUNT) {
+        throw std::runtime_error("Invalid packed move");
+    }
+    return Move(player, code & 3, PATHS[path].d1, PATHS[path].d2, static_cast<Direction>((code >> 2) & 3));
+}
+
+// GameDatabaseBuilder implementation
+
+void GameDatabaseBuilder::add(const Game& game, std::optional<std::pair<PlayerColor, Reason>> outcome) {
+    uint32_t id = static_cast<uint32_t>(records_.size());
+    std::vector<Piece> placements = game.placements();
+    std::vector<Move> history = game.history();
+    if (history.size() > UINT16_MAX) {
+        throw std::runtime_error("Game is too long to store");
+    }
+
+    GameRecord record{};
+    std::fill(std::begin(record.placements), std::end(record.placements), GAME_DB_NO_PLACEMENT);
+    record.move_count = static_cast<uint16_t>(history.size());
+    record.move_bit_offset = move_bits_;
+
+    // Replay the game to index every position it reaches. If the game turns out to be invalid partway through, drop
+    // what it added so that the next game does not inherit its positions under the same id.
+    size_t positions_before = positions_.size(), moves_before = moves_.size();
+    uint64_t move_bits_before = move_bits_;
+    Game replay;
+    uint16_t ply = 0;
+    try {
+        for (const Piece& piece : placements) {
+            if (ply >= PLACEMENT_ORDER.size() || piece.owner != PLACEMENT_ORDER[ply] || piece.id != ply / 2) {
+                throw std::runtime_error("Placements are not in RBBRRBBR order");
+            }
+            record.placements[ply] = static_cast<uint8_t>(piece.pos.r * 7 + piece.pos.c);
+            replay.place_piece(piece.pos, piece.owner, piece.id);
+            ++ply;
+            positions_.push_back({zobrist::hash(replay.board(), player_to_act(ply)), id, ply, 0});
+        }
+        for (const Move& move : history) {
+            // Moves are stored without their player, which moves() infers from this order.
+            if (ply < PLACEMENT_ORDER.size() || move.player() != player_to_act(ply)) {
+                throw std::runtime_error("Moves do not alternate from Red after the placements");
+            }
+            replay.apply_move(move);
+            ++ply;
+            positions_.push_back({zobrist::hash(replay.board(), player_to_act(ply)), id, ply, 0});
+
+            uint16_t code = pack_move_9bit(move);
+            for (int i = 0; i < 9; ++i, ++move_bits_) {
+                if ((move_bits_ & 7) == 0) moves_.push_back(0);
+                moves_.back() |= ((code >> i) & 1) << (move_bits_ & 7);
+            }
+        }
+    } catch (...) {
+        positions_.resize(positions_before);
+        moves_.resize(moves_before);
+        if (move_bits_before & 7) moves_.back() &= static_cast<uint8_t>((1 << (move_bits_before & 7)) - 1);
+        move_bits_ = move_bits_before;
+        throw;
+    }
+
+    Board board = replay.board();
+    auto territory = board.get_territory();
+    record.red_total = territory.red_total;
+    record.red_max = territory.red_max;
+    record.blue_total = territory.blue_total;
+    record.blue_max = territory.blue_max;
+
+    if (!outcome) {
+        if (placements.size() < PLACEMENT_ORDER.size() || !board.is_game_over()) {
+            outcome = {opponent_of(player_to_act(ply)), OPPONENT_TLE};
+        } else {
+            outcome = decide_winner(territory, player_to_act(ply - 1));
+        }
+    }
+    record.winner = static_cast<uint8_t>(outcome->first);
+    record.reason = static_cast<uint8_t>(outcome->second);
+    records_.push_back(record);
+}
+
+void GameDatabaseBuilder::add(const std::string& encoded_game) { add(Game::decode(encoded_game), std::nullopt); }
+
+void GameDatabaseBuilder::add(const GameOutcome& outcome) {
+    add(Game::decode(outcome.encoded_game), std::make_pair(outcome.winner, outcome.reason));
+}
+
+size_t GameDatabaseBuilder::size() const { return records_.size(); }
+
+void GameDatabaseBuilder::write(const std::string& path) const {
+    GameDbHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = GAME_DB_VERSION;
+    header.game_count = static_cast<uint32_t>(records_.size());
+    header.position_count = positions_.size();
+    header.move_bytes = moves_.size();
+
+    // Counting sort of the game ids by (winner, reason).
+    auto bucket = [](const GameRecord& record) { return (record.winner - 1) * 5 + record.reason; };
+    for (const GameRecord& record : records_) {
+        ++header.outcome_offsets[bucket(record) + 1];
+    }
+    for (int b = 0; b < 10; ++b) {
+        header.outcome_offsets[b + 1] += header.outcome_offsets[b];
+    }
+    std::vector<uint32_t> outcome_games(records_.size());
+    std::array<uint32_t, 10> next;
+    std::copy(header.outcome_offsets, header.outcome_offsets + 10, next.begin());
+    for (uint32_t id = 0; id < records_.size(); ++id) {
+        outcome_games[next[bucket(records_[id])]++] = id;
+    }
+
+    std::vector<PositionEntry> positions = positions_;
+    std::sort(positions.begin(), positions.end(), [](const PositionEntry& a, const PositionEntry& b) {
+        return std::tie(a.key, a.game, a.ply) < std::tie(b.key, b.game, b.ply);
+    });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records_.data()), records_.size() * sizeof(GameRecord));
+    out.write(reinterpret_cast<const char*>(outcome_games.data()), outcome_games.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(PositionEntry));
+    out.write(reinterpret_cast<const char*>(moves_.data()), moves_.size());
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+// GameDatabase implementation
+
+GameDatabase::GameDatabase(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(GameDbHeader)) {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a game database");
+    }
+    size_ = st.st_size;
+    void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map " + path);
+    }
+    data_ = static_cast<const uint8_t*>(mapped);
+
+    header_ = reinterpret_cast<const GameDbHeader*>(data_);
+    size_t expected = sizeof(GameDbHeader) + header_->game_count * (sizeof(GameRecord) + sizeof(uint32_t)) +
+                      header_->position_count * sizeof(PositionEntry) + header_->move_bytes;
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0 || header_->version != GAME_DB_VERSION ||
+        expected != size_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+        throw std::runtime_error(path + " is not a game database");
+    }
+
+    const uint8_t* p = data_ + sizeof(GameDbHeader);
+    records_ = reinterpret_cast<const GameRecord*>(p);
+    p += header_->game_count * sizeof(GameRecord);
+    outcome_games_ = reinterpret_cast<const uint32_t*>(p);
+    p += header_->game_count * sizeof(uint32_t);
+    positions_ = reinterpret_cast<const PositionEntry*>(p);
+    p += header_->position_count * sizeof(PositionEntry);
+    moves_ = p;
+}
+
+GameDatabase::~GameDatabase() {
+    if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+size_t GameDatabase::size() const { return header_->game_count; }
+
+std::span<const GameRecord> GameDatabase::records() const { return {records_, header_->game_count}; }
+
+const GameRecord& GameDatabase::record(uint32_t game) const {
+    if (game >= header_->game_count) {
+        throw std::out_of_range("Game id out of range");
+    }
+    return records_[game];
+}
+
+std::span<const uint32_t> GameDatabase::games_by_outcome(PlayerColor winner, Reason reason) const {
+    int b = (static_cast<int>(winner) - 1) * 5 + reason;
+    return {outcome_games_ + header_->outcome_offsets[b], outcome_games_ + header_->outcome_offsets[b + 1]};
+}
+
+std::span<const PositionEntry> GameDatabase::find_position(uint64_t key) const {
+    const PositionEntry* end = positions_ + header_->position_count;
+    auto lo = std::lower_bound(positions_, end, key, [](const PositionEntry& e, uint64_t k) { return e.key < k; });
+    auto hi = std::upper_bound(lo, end, key, [](uint64_t k, const PositionEntry& e) { return k < e.key; });
+    return {lo, hi};
+}
+
+uint64_t GameDatabase::position_key(const Board& board, PlayerColor to_act) { return zobrist::hash(board, to_act); }
+
+uint64_t GameDatabase::position_key(const Game& game) {
+    return zobrist::hash(game.board(), player_to_act(game.placements().size() + game.history().size()));
+}
+
+std::vector<Piece> GameDatabase::placements(uint32_t game) const {
+    const GameRecord& rec = record(game);
+    std::vector<Piece> pieces;
+    for (int i = 0; i < 8 && rec.placements[i] != GAME_DB_NO_PLACEMENT; ++i) {
+        pieces.push_back(Piece{PLACEMENT_ORDER[i], {rec.placements[i] / 7, rec.placements[i] % 7}, i / 2});
+    }
+    return pieces;
+}
+
+std::vector<Move> GameDatabase::moves(uint32_t game) const {
+    const GameRecord& rec = record(game);
+    std::vector<Move> moves;
+    moves.reserve(rec.move_count);
+    for (int i = 0; i < rec.move_count; ++i) {
+        uint16_t code = read_bits(moves_, rec.move_bit_offset + 9ull * i, 9);
+        moves.push_back(unpack_move_9bit(code, i % 2 == 0 ? PlayerColor::Red : PlayerColor::Blue));
+    }
+    return moves;
+}
+
+std::string GameDatabase::encode(uint32_t game) const {
+    std::string s;
+    for (const Piece& piece : placements(game)) {
+        s += static_cast<char>('0' + piece.pos.r);
+        s += static_cast<char>('0' + piece.pos.c);
+        s += static_cast<char>('0' + static_cast<int>(piece.owner));
+        s += static_cast<char>('0' + piece.id);
+    }
+    s += '_';
+    for (const Move& move : moves(game)) {
+        s += move.encode();
+    }
+    return s;
+}
+
+Game GameDatabase::replay(uint32_t game, int ply) const {
+    Game result;
+    int done = 0;
+    for (const Piece& piece : placements(game)) {
+        if (ply >= 0 && done >= ply) return result;
+        result.place_piece(piece.pos, piece.owner, piece.id);
+        ++done;
+    }
+    for (const Move& move : moves(game)) {
+        if (ply >= 0 && done >= ply) return result;
+        result.apply_move(move);
+        ++done;
+    }
+    return result;
+}
+
+}  // namespace wallgo
@@ -0,0 +1,143 @@
+#ifndef WALLGO_GAME_DB_H
+#define WALLGO_GAME_DB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+// Binary game database. A database file holds, in this order:
+//   GameDbHeader
+//   GameRecord[game_count]           fixed-size outcome header of every game
+//   uint32_t[game_count]             game ids grouped by (winner, reason), see GameDbHeader::outcome_offsets
+//   PositionEntry[position_count]    every position reached by every game, sorted by key
+//   uint8_t[move_bytes]              9-bit move codes of all games, bit-packed least significant bit first
+// Integers are stored in host byte order. The file is read through mmap, so queries touch only the pages they need.
+
+constexpr uint32_t GAME_DB_VERSION = 1;
+
+// Marks a placement that never happened because the game was forfeited during the placement phase.
+constexpr uint8_t GAME_DB_NO_PLACEMENT = 0xff;
+
+struct GameDbHeader {
+    char magic[8];  // "WALLGODB"
+    uint32_t version;
+    uint32_t game_count;
+    uint64_t position_count;
+    uint64_t move_bytes;
+    // Games won by `winner` for `reason` are outcome_games[outcome_offsets[b]] .. outcome_games[outcome_offsets[b+1]]
+    // where b = (winner - 1) * 5 + reason.
+    uint32_t outcome_offsets[11];
+    uint32_t reserved;
+};
+
+struct GameRecord {
+    uint8_t placements[8];  // Cell index r * 7 + c of each placement, in RBBRRBBR order
+    uint8_t winner;         // PlayerColor
+    uint8_t reason;         // Reason
+    uint8_t red_total, red_max, blue_total, blue_max;
+    uint16_t move_count;
+    uint64_t move_bit_offset;  // Offset of the first move code in the move stream, in bits
+};
+
+// A position reached in a game. ply counts the placements and moves made so far, so placements are plies 1 to 8
+// and the first move leads to ply 9.
+struct PositionEntry {
+    uint64_t key;
+    uint32_t game;
+    uint16_t ply;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(GameDbHeader) == 80);
+static_assert(sizeof(GameRecord) == 24);
+static_assert(sizeof(PositionEntry) == 16);
+
+// Packs a move into 9 bits: the piece id in the low 2 bits, then the step path and wall direction. The player is not
+// stored as it follows from the ply.
+uint16_t pack_move_9bit(const Move& move);
+Move unpack_move_9bit(uint16_t code, PlayerColor player);
+
+// Collects games in memory and writes them out as a database file.
+class GameDatabaseBuilder {
+   private:
+    std::vector<GameRecord> records_;
+    std::vector<PositionEntry> positions_;
+    std::vector<uint8_t> moves_;
+    uint64_t move_bits_ = 0;
+
+    void add(const Game& game, std::optional<std::pair<PlayerColor, Reason>> forfeit);
+
+   public:
+    // Adds a game from its game string. Games that did not reach the end are recorded as lost on time by the player
+    // to act, since the string does not say whether that player timed out or made an illegal move.
+    // Throws std::runtime_error if the string is malformed.
+    void add(const std::string& encoded_game);
+
+    // Adds a game using the winner and reason reported by the controller.
+    void add(const GameOutcome& outcome);
+
+    size_t size() const;
+
+    // Writes the database to path. Throws std::runtime_error if the file cannot be written.
+    void write(const std::string& path) const;
+};
+
+// Read-only view of a database file, mapped into memory.
+class GameDatabase {
+   private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    const GameDbHeader* header_ = nullptr;
+    const GameRecord* records_ = nullptr;
+    const uint32_t* outcome_games_ = nullptr;
+    const PositionEntry* positions_ = nullptr;
+    const uint8_t* moves_ = nullptr;
+
+   public:
+    // Maps the database at path. Throws std::runtime_error if the file cannot be opened or is not a database.
+    explicit GameDatabase(const std::string& path);
+    ~GameDatabase();
+
+    GameDatabase(const GameDatabase&) = delete;
+    GameDatabase& operator=(const GameDatabase&) = delete;
+
+    // Number of games in the database.
+    size_t size() const;
+
+    // Outcome headers of all games, indexed by game id.
+    std::span<const GameRecord> records() const;
+    const GameRecord& record(uint32_t game) const;
+
+    // Ids of the games won by winner for reason, in insertion order.
+    std::span<const uint32_t> games_by_outcome(PlayerColor winner, Reason reason) const;
+
+    // All occurrences of the position with the given key, see position_key.
+    std::span<const PositionEntry> find_position(uint64_t key) const;
+
+    // Key of the position on board with to_act to place or move next.
+    static uint64_t position_key(const Board& board, PlayerColor to_act);
+
+    // Key of the current position of game.
+    static uint64_t position_key(const Game& game);
+
+    // Decodes the pieces placed and moves made in a game.
+    std::vector<Piece> placements(uint32_t game) const;
+    std::vector<Move> moves(uint32_t game) const;
+
+    // Rebuilds the game string of a game without replaying it.
+    std::string encode(uint32_t game) const;
+
+    // Replays a game up to the given ply, or to the end if ply is negative.
+    Game replay(uint32_t game, int ply = -1) const;
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_GAME_DB_H
@@ -0,0 +1,111 @@
+#ifndef WALLGO_GEOMETRY_H
+#define WALLGO_GEOMETRY_H
+
+#include <array>
+#include <cstdint>
+
+namespace wallgo {
+
+// A way for a piece to move 0, 1 or 2 steps. Unused steps are -1. Paths that return to their start are left out,
+// since the piece itself blocks the start cell.
+struct MovePath {
+    int8_t direction1, direction2;
+    int8_t via;         // Cell after the first step, or the start for paths without steps
+    int8_t target;      // Cell the piece ends up on
+    int8_t crossed[2];  // Edges crossed by each step, -1 for unused steps
+};
+
+// The paths starting on one cell; at most 1 + 4 + 4 * 3.
+struct MovePaths {
+    static constexpr int MAX = 17;
+
+    int count;
+    std::array<MovePath, MAX> path;
+};
+
+namespace geometry_detail {
+
+constexpr int STEP_R[4] = {-1, 1, 0, 0};
+constexpr int STEP_C[4] = {0, 0, -1, 1};
+
+template <int N>
+constexpr int step(int cell, int d) {
+    int r = cell / N + STEP_R[d], c = cell % N + STEP_C[d];
+    return r < 0 || r >= N || c < 0 || c >= N ? -1 : r * N + c;
+}
+
+template <int N>
+constexpr int edge(int cell, int d) {
+    int r = cell / N, c = cell % N;
+    switch (d) {
+        case 0:
+            return r == 0 ? -1 : N * (N - 1) + (r - 1) * N + c;
+        case 1:
+            return r == N - 1 ? -1 : N * (N - 1) + r * N + c;
+        case 2:
+            return c == 0 ? -1 : r * (N - 1) + c - 1;
+        default:
+            return c == N - 1 ? -1 : r * (N - 1) + c;
+    }
+}
+
+template <int N, int (*F)(int, int)>
+constexpr std::array<std::array<int8_t, 4>, N * N> table() {
+    std::array<std::array<int8_t, 4>, N * N> result = {};
+    for (int cell = 0; cell < N * N; ++cell) {
+        for (int d = 0; d < 4; ++d) result[cell][d] = static_cast<int8_t>(F(cell, d));
+    }
+    return result;
+}
+
+// Paths in the order Board::get_valid_moves has always listed moves: no step, then for each first direction the
+// single step followed by the two-step paths through it.
+template <int N>
+constexpr std::array<MovePaths, N * N> paths() {
+    std::array<MovePaths, N * N> result = {};
+    for (int cell = 0; cell < N * N; ++cell) {
+        MovePaths& paths = result[cell];
+        auto i8 = [](int x) { return static_cast<int8_t>(x); };
+        paths.path[paths.count++] = {-1, -1, i8(cell), i8(cell), {-1, -1}};
+        for (int d1 = 0; d1 < 4; ++d1) {
+            int via = step<N>(cell, d1);
+            if (via < 0) continue;
+            paths.path[paths.count++] = {i8(d1), -1, i8(via), i8(via), {i8(edge<N>(cell, d1)), -1}};
+            for (int d2 = 0; d2 < 4; ++d2) {
+                int target = step<N>(via, d2);
+                if (target < 0 || target == cell) continue;
+                paths.path[paths.count++] = {i8(d1), i8(d2), i8(via), i8(target),
+                                             {i8(edge<N>(cell, d1)), i8(edge<N>(via, d2))}};
+            }
+        }
+    }
+    return result;
+}
+
+}  // namespace geometry_detail
+
+// Tables of an N x N board, computed at compile time. Cells are indexed r * N + c and directions as in Direction:
+// Up, Down, Left, Right.
+//
+// Interior edges are numbered as in zobrist::edge_index: first the N * (N - 1) edges between horizontal neighbours,
+// row by row, then the (N - 1) * N edges between vertical neighbours.
+template <int N>
+struct Geometry {
+    static constexpr int CELLS = N * N;
+    static constexpr int EDGES = 2 * N * (N - 1);
+
+    // Neighbour of each cell in each direction, -1 off the board.
+    static constexpr std::array<std::array<int8_t, 4>, CELLS> neighbor =
+        geometry_detail::table<N, geometry_detail::step<N>>();
+
+    // Interior edge on each side of each cell, -1 on the border.
+    static constexpr std::array<std::array<int8_t, 4>, CELLS> edge =
+        geometry_detail::table<N, geometry_detail::edge<N>>();
+
+    // Paths starting on each cell.
+    static constexpr std::array<MovePaths, CELLS> paths = geometry_detail::paths<N>();
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_GEOMETRY_H
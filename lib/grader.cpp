@@ -1,6 +1,9 @@
+#include <fstream>
 #include <iomanip>
 
+#include "engine.h"
 #include "game_controller.h"
+#include "sandbox.h"
 #include "types.h"
 
 namespace red {
@@ -11,7 +14,14 @@ namespace blue {
 std::unique_ptr<wallgo::Player> get();
 }
 
-int main() {
+// Usage: exec.exe [--tc time_control] [--sandbox] [--red-engine command] [--blue-engine command] [trace.jsonl]
+// The time control is given as in wallgo::TimeControl::parse, e.g. --tc budget=5,inc=0.05 or --tc nodes=20000.
+// --red-engine and --blue-engine play that side with an engine process started by the command (see engine.h and
+// tools/compile_engine.sh) instead of the strategy linked in.
+// --sandbox runs the linked strategies in forked processes that are charged CPU time and killed on their deadline,
+// see sandbox.h.
+// If a trace file is given, the statistics of every decision are written to it as JSON lines.
+int main(int argc, char** argv) {
     // Initialize the game controller with players and seed
     int seed = std::chrono::steady_clock::now().time_since_epoch().count() % (int)(1e9 + 7);
     std::unique_ptr<wallgo::Player> player1 = red::get();
@@ -19,7 +29,45 @@ int main() {
 
     std::cout << std::fixed << std::setprecision(5);
 
-    wallgo::GameController controller(seed, std::move(player1), std::move(player2), std::cout);
+    wallgo::TimeControl time_control;
+    std::ofstream trace;
+    bool sandbox = false, red_engine = false, blue_engine = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tc" && i + 1 < argc) {
+            try {
+                time_control = wallgo::TimeControl::parse(argv[++i]);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sandbox") {
+            sandbox = true;
+        } else if ((arg == "--red-engine" || arg == "--blue-engine") && i + 1 < argc) {
+            try {
+                auto engine = std::make_shared<wallgo::EngineProcess>(argv[++i]);
+                (arg == "--red-engine" ? player1 : player2) = std::make_unique<wallgo::EnginePlayer>(engine);
+                (arg == "--red-engine" ? red_engine : blue_engine) = true;
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else {
+            trace.open(arg);
+            if (!trace) {
+                std::cerr << "Cannot open " << arg << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (sandbox) {
+        if (!red_engine) player1 = std::make_unique<wallgo::SandboxedPlayer>(red::get);
+        if (!blue_engine) player2 = std::make_unique<wallgo::SandboxedPlayer>(blue::get);
+    }
+
+    wallgo::GameController controller(seed, std::move(player1), std::move(player2), std::cout,
+                                      trace.is_open() ? &trace : nullptr, time_control);
 
     // Run the game
     wallgo::GameOutcome outcome = controller.run();
@@ -27,6 +75,16 @@ int main() {
     // Output the result
     std::cout << "Winner: " << static_cast<int>(outcome.winner) << ", Reason: " << static_cast<int>(outcome.reason)
               << ", Message: " << outcome.message << std::endl;
+    for (int player = 1; player <= 2; ++player) {
+        const wallgo::PlayerTiming& timing = outcome.timing[player];
+        std::cout << "Player " << player << " time: init " << timing.init_time << "s, placement "
+                  << timing.placement_time << "s, movement " << timing.movement_time << "s";
+        if (const wallgo::DecisionTime* slowest = timing.slowest()) {
+            std::cout << ", slowest " << slowest->time << "s at ply " << slowest->ply << ", least remaining "
+                      << timing.min_remaining() << "s";
+        }
+        std::cout << std::endl;
+    }
 
     std::cout << "\n\ngame string:\n" << outcome.encoded_game << std::endl;
     return 0;
@@ -0,0 +1,297 @@
+#include "inference.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WALLGO_X86 1
+#include <immintrin.h>
+#endif
+
+namespace wallgo {
+namespace inference {
+
+namespace {
+
+constexpr char MAGIC[8] = {'W', 'G', 'M', 'L', 'P', '0', '0', '1'};
+
+// Inputs per block of the hidden layer: a block of 64 inputs by 16 hidden units is 4 KB of weights, which stays in
+// L1 while every tile of rows is multiplied by it.
+constexpr int K_BLOCK = 64;
+constexpr int J_BLOCK = 16;
+static_assert(HIDDEN % J_BLOCK == 0);
+
+// Computes hidden[r][j] = bias[j] + sum over k of x[r][k] * w[k][j], before the activation, for padded_rows rows.
+// Both versions sum k in ascending order and do not fuse multiplies and adds, so they round the same way.
+namespace scalar {
+
+void hidden_layer(const float* x, int padded_rows, const Weights& weights, float* hidden) {
+    for (int j0 = 0; j0 < HIDDEN; j0 += J_BLOCK) {
+        for (int k0 = 0; k0 < INPUTS; k0 += K_BLOCK) {
+            int k1 = std::min(INPUTS, k0 + K_BLOCK);
+            for (int r = 0; r < padded_rows; ++r) {
+                const float* row = x + r * STRIDE;
+                float* out = hidden + r * HIDDEN + j0;
+                for (int j = 0; j < J_BLOCK; ++j) {
+                    float sum = k0 == 0 ? weights.hidden_bias[j0 + j] : out[j];
+                    for (int k = k0; k < k1; ++k) {
+                        sum += row[k] * weights.hidden_weights[k][j0 + j];
+                    }
+                    out[j] = sum;
+                }
+            }
+        }
+    }
+}
+
+}  // namespace scalar
+
+#ifdef WALLGO_X86
+
+#define WALLGO_AVX2 __attribute__((target("avx2")))
+
+namespace avx2 {
+
+WALLGO_AVX2 void hidden_layer(const float* x, int padded_rows, const Weights& weights, float* hidden) {
+    for (int j0 = 0; j0 < HIDDEN; j0 += J_BLOCK) {
+        __m256 bias[2] = {_mm256_loadu_ps(&weights.hidden_bias[j0]), _mm256_loadu_ps(&weights.hidden_bias[j0 + 8])};
+        for (int k0 = 0; k0 < INPUTS; k0 += K_BLOCK) {
+            int k1 = std::min(INPUTS, k0 + K_BLOCK);
+            // A tile of ROW_TILE rows by 16 units is held in 8 registers; each weight is loaded once per tile.
+            for (int r0 = 0; r0 < padded_rows; r0 += ROW_TILE) {
+                __m256 sum[ROW_TILE][2];
+                for (int r = 0; r < ROW_TILE; ++r) {
+                    float* out = hidden + (r0 + r) * HIDDEN + j0;
+                    sum[r][0] = k0 == 0 ? bias[0] : _mm256_loadu_ps(out);
+                    sum[r][1] = k0 == 0 ? bias[1] : _mm256_loadu_ps(out + 8);
+                }
+                for (int k = k0; k < k1; ++k) {
+                    __m256 w0 = _mm256_loadu_ps(&weights.hidden_weights[k][j0]);
+                    __m256 w1 = _mm256_loadu_ps(&weights.hidden_weights[k][j0 + 8]);
+                    for (int r = 0; r < ROW_TILE; ++r) {
+                        __m256 v = _mm256_broadcast_ss(x + (r0 + r) * STRIDE + k);
+                        sum[r][0] = _mm256_add_ps(sum[r][0], _mm256_mul_ps(v, w0));
+                        sum[r][1] = _mm256_add_ps(sum[r][1], _mm256_mul_ps(v, w1));
+                    }
+                }
+                for (int r = 0; r < ROW_TILE; ++r) {
+                    float* out = hidden + (r0 + r) * HIDDEN + j0;
+                    _mm256_storeu_ps(out, sum[r][0]);
+                    _mm256_storeu_ps(out + 8, sum[r][1]);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace avx2
+
+#endif  // WALLGO_X86
+
+struct Implementation {
+    const char* name;
+    void (*hidden_layer)(const float*, int, const Weights&, float*);
+};
+
+Implementation choose() {
+#ifdef WALLGO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", avx2::hidden_layer};
+    }
+#endif
+    return {"scalar", scalar::hidden_layer};
+}
+
+const Implementation& implementation() {
+    static const Implementation chosen = choose();
+    return chosen;
+}
+
+// The opponent's view of a position swaps my planes with theirs.
+constexpr std::array<int, PLANES> OPPONENT_PLANE = {1, 0, 4, 5, 2, 3};
+
+}  // namespace
+
+Planes encode(const Board& board, PlayerColor player) {
+    Planes planes = {};
+    auto plane = [&](int index, int r, int c) -> uint8_t& { return planes[index * 49 + r * 7 + c]; };
+    for (int r = 0; r < 7; ++r) {
+        for (int c = 0; c < 7; ++c) {
+            const Cell& cell = board.get({r, c});
+            if (auto piece = cell.piece()) {
+                plane(piece->owner == player ? 0 : 1, r, c) = 1;
+            }
+            for (int side = 0; side < 2; ++side) {
+                WallType wall = cell.wall(side == 0 ? Direction::Right : Direction::Down);
+                if (wall != WallType::PlayerRed && wall != WallType::PlayerBlue) continue;
+                bool mine = (wall == WallType::PlayerRed) == (player == PlayerColor::Red);
+                plane((mine ? 2 : 4) + side, r, c) = 1;
+            }
+        }
+    }
+    return planes;
+}
+
+void Batch::add(const Planes& planes) {
+    ++size_;
+    values_.resize(static_cast<size_t>(padded_rows()) * STRIDE);
+    float* mine = values_.data() + static_cast<size_t>(2 * size_ - 2) * STRIDE;
+    float* theirs = mine + STRIDE;
+    for (int p = 0; p < PLANES; ++p) {
+        for (int i = 0; i < 49; ++i) {
+            mine[p * 49 + i] = planes[p * 49 + i];
+            theirs[OPPONENT_PLANE[p] * 49 + i] = planes[p * 49 + i];
+        }
+    }
+}
+
+void Batch::clear() {
+    values_.clear();
+    size_ = 0;
+}
+
+Model::Model(std::shared_ptr<const Weights> weights) : weights_(std::move(weights)) {}
+
+Model Model::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    char magic[8];
+    uint32_t dimensions[2];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions));
+    if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a model file");
+    }
+    if (dimensions[0] != PLANES || dimensions[1] != HIDDEN) {
+        throw std::runtime_error(path + " has different dimensions than this build");
+    }
+
+    auto weights = std::make_shared<Weights>();
+    auto read = [&](auto& field) { in.read(reinterpret_cast<char*>(&field), sizeof(field)); };
+    read(weights->hidden_bias);
+    read(weights->hidden_weights);
+    read(weights->output_bias);
+    read(weights->output_weights);
+    if (!in) throw std::runtime_error(path + " is truncated");
+    return Model(std::move(weights));
+}
+
+Model Model::random(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal(0, 1);
+    auto weights = std::make_shared<Weights>();
+    for (auto& bias : weights->hidden_bias) bias = 0.1f * normal(rng);
+    for (auto& row : weights->hidden_weights) {
+        for (auto& weight : row) weight = 0.2f * normal(rng);
+    }
+    weights->output_bias = 0;
+    for (auto& weight : weights->output_weights) weight = 0.5f * normal(rng);
+    return Model(std::move(weights));
+}
+
+void Model::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    uint32_t dimensions[2] = {PLANES, HIDDEN};
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+    auto write = [&](const auto& field) { out.write(reinterpret_cast<const char*>(&field), sizeof(field)); };
+    write(weights_->hidden_bias);
+    write(weights_->hidden_weights);
+    write(weights_->output_bias);
+    write(weights_->output_weights);
+    if (!out.flush()) throw std::runtime_error("Cannot write " + path);
+}
+
+std::vector<double> Model::evaluate(const Batch& batch) const {
+    const Weights& weights = *weights_;
+    int rows = batch.padded_rows();
+    thread_local std::vector<float> hidden;
+    hidden.resize(static_cast<size_t>(rows) * HIDDEN);
+    implementation().hidden_layer(batch.data(), rows, weights, hidden.data());
+
+    std::vector<double> scores(batch.size());
+    for (int i = 0; i < batch.size(); ++i) {
+        float outputs[2];
+        for (int view = 0; view < 2; ++view) {
+            const float* h = hidden.data() + (2 * i + view) * HIDDEN;
+            float sum = weights.output_bias;
+            for (int j = 0; j < HIDDEN; ++j) {
+                sum += std::max(h[j], 0.0f) * weights.output_weights[j];
+            }
+            outputs[view] = sum;
+        }
+        scores[i] = 0.5 * (outputs[0] - outputs[1]);
+    }
+    return scores;
+}
+
+InferenceEngine::InferenceEngine(Model model, const Options& options)
+    : model_(std::move(model)), options_(options), worker_([this] { run(); }) {}
+
+InferenceEngine::~InferenceEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pending_changed_.notify_all();
+    worker_.join();
+}
+
+std::future<double> InferenceEngine::submit(const Board& board, PlayerColor player) {
+    Request request{encode(board, player), {}, std::chrono::steady_clock::now()};
+    std::future<double> score = request.score.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(request));
+    }
+    pending_changed_.notify_one();
+    return score;
+}
+
+InferenceEngine::Stats InferenceEngine::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void InferenceEngine::run() {
+    Batch batch;
+    std::vector<Request> taken;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        pending_changed_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+        if (pending_.empty()) break;
+        auto deadline = pending_.front().submitted + options_.max_wait;
+        pending_changed_.wait_until(lock, deadline, [&] {
+            return stopping_ || static_cast<int>(pending_.size()) >= options_.max_batch;
+        });
+
+        int count = std::min<int>(options_.max_batch, pending_.size());
+        for (int i = 0; i < count; ++i) {
+            taken.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+        }
+        ++stats_.batches;
+        stats_.positions += count;
+        lock.unlock();
+
+        batch.clear();
+        for (const Request& request : taken) {
+            batch.add(request.planes);
+        }
+        std::vector<double> scores = model_.evaluate(batch);
+        for (int i = 0; i < count; ++i) {
+            taken[i].score.set_value(scores[i]);
+        }
+        taken.clear();
+        lock.lock();
+    }
+}
+
+const char* isa() { return implementation().name; }
+
+}  // namespace inference
+}  // namespace wallgo
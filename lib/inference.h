@@ -0,0 +1,144 @@
+#ifndef WALLGO_INFERENCE_H
+#define WALLGO_INFERENCE_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+// Batched evaluation of positions by a small dense network, for searches that have many leaves to score at once.
+//
+// Positions are encoded as PLANES planes of 7x7 cells seen from one player: my pieces, the opponent's pieces, then
+// the walls I placed on the right and on the bottom edge of each cell, and the same two for the opponent. Border walls
+// are not encoded. A batch stores the planes of each position and view in one row of floats, and the hidden layer
+// multiplies the whole batch by its weights in tiles of rows and columns, so each block of weights is loaded once per
+// tile of rows instead of once per position. As in eval_kernels.h, AVX2 is used if the CPU supports it; both versions
+// sum in the same order and give identical results.
+namespace inference {
+
+constexpr int PLANES = 6;
+constexpr int INPUTS = PLANES * 49;
+constexpr int STRIDE = 296;  // Floats per row: INPUTS rounded up to whole AVX2 registers
+constexpr int HIDDEN = 64;
+constexpr int ROW_TILE = 4;  // Rows per tile; batches are padded to a multiple of it
+
+// Planes of one position from one player's view, one byte per cell.
+using Planes = std::array<uint8_t, INPUTS>;
+
+Planes encode(const Board& board, PlayerColor player);
+
+// Rows of planes laid out back to back, STRIDE floats each.
+class Batch {
+   private:
+    std::vector<float> values_;
+    int size_ = 0;
+
+   public:
+    // Number of positions. Each takes two rows, one from either view.
+    int size() const { return size_; }
+    int padded_rows() const { return (2 * size_ + ROW_TILE - 1) / ROW_TILE * ROW_TILE; }
+    const float* data() const { return values_.data(); }
+
+    // Appends a position encoded from player's view, followed by the same position from the opponent's view.
+    void add(const Planes& planes);
+    void clear();
+};
+
+struct Weights {
+    std::array<float, HIDDEN> hidden_bias;
+    std::array<std::array<float, HIDDEN>, INPUTS> hidden_weights;  // Indexed [input][hidden unit]
+    float output_bias;
+    std::array<float, HIDDEN> output_weights;
+};
+
+class Model {
+   private:
+    std::shared_ptr<const Weights> weights_;
+
+   public:
+    explicit Model(std::shared_ptr<const Weights> weights);
+
+    // Reads a model from a file: the magic "WGMLP001", the uint32 dimensions PLANES and HIDDEN, then the fields of
+    // Weights in order as host byte order floats. Throws std::runtime_error if it is missing or malformed.
+    static Model load(const std::string& path);
+
+    // Small random weights, for tests and as a starting point for training.
+    static Model random(uint32_t seed);
+
+    // Writes the model in the format load reads. Throws std::runtime_error on failure.
+    void save(const std::string& path) const;
+
+    // Scores every position in batch from the view it was added with, in cells. Like Evaluator::evaluate, the score
+    // is antisymmetric: it is half the difference between the network's outputs from both views.
+    std::vector<double> evaluate(const Batch& batch) const;
+};
+
+// Collects positions submitted by several search threads and evaluates them in batches on a background thread.
+//
+// A batch is run once max_batch positions are pending, or once the oldest has waited max_wait; a search thread that
+// submits a leaf can keep selecting other leaves and wait on the future only when it needs the score.
+class InferenceEngine {
+   public:
+    struct Options {
+        int max_batch = 64;
+        std::chrono::microseconds max_wait{200};
+    };
+
+    struct Stats {
+        uint64_t batches = 0;
+        uint64_t positions = 0;
+    };
+
+   private:
+    struct Request {
+        Planes planes;
+        std::promise<double> score;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    Model model_;
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable pending_changed_;
+    std::deque<Request> pending_;
+    bool stopping_ = false;
+    Stats stats_;
+    std::thread worker_;
+
+    void run();
+
+   public:
+    explicit InferenceEngine(Model model, const Options& options);
+    explicit InferenceEngine(Model model) : InferenceEngine(std::move(model), Options()) {}
+
+    // Evaluates the pending positions and stops the background thread.
+    ~InferenceEngine();
+
+    InferenceEngine(const InferenceEngine&) = delete;
+    InferenceEngine& operator=(const InferenceEngine&) = delete;
+
+    // Queues the board for evaluation from player's point of view. The board is encoded by the calling thread.
+    std::future<double> submit(const Board& board, PlayerColor player);
+
+    Stats stats() const;
+};
+
+// Name of the instruction set in use: "avx2" or "scalar".
+const char* isa();
+
+}  // namespace inference
+
+}  // namespace wallgo
+
+#endif  // WALLGO_INFERENCE_H
@@ -0,0 +1,100 @@
+#ifndef WALLGO_INSTRUMENTATION_H
+#define WALLGO_INSTRUMENTATION_H
+
+#include <algorithm>
+#include <chrono>
+
+#include "types.h"
+
+// Counters and phase timers for search code. Compile with -DWALLGO_INSTRUMENT to enable them; otherwise every macro
+// here expands to nothing.
+//
+//   WALLGO_RECORD_SEARCH(stats);      records into stats on this thread until the end of the enclosing scope
+//   WALLGO_COUNT(nodes, 1);           adds to a SearchStats counter
+//   WALLGO_MAX(depth, 6);             raises a SearchStats field to at least a value, as operator+= merges depth
+//   WALLGO_PHASE(bfs_seconds);        adds the time until the end of the enclosing scope to a SearchStats timer
+//
+// Counters and timers are dropped on threads that are not recording.
+
+#ifdef WALLGO_INSTRUMENT
+
+namespace wallgo {
+namespace instrument {
+
+// Stats that the current thread records into, or nullptr.
+inline SearchStats*& current() {
+    thread_local SearchStats* stats = nullptr;
+    return stats;
+}
+
+class Recording {
+   private:
+    SearchStats* previous_;
+
+   public:
+    explicit Recording(SearchStats& stats) : previous_(current()) { current() = &stats; }
+    ~Recording() { current() = previous_; }
+
+    Recording(const Recording&) = delete;
+    Recording& operator=(const Recording&) = delete;
+};
+
+class PhaseTimer {
+   private:
+    double SearchStats::*field_;
+    std::chrono::steady_clock::time_point start_;
+
+   public:
+    explicit PhaseTimer(double SearchStats::*field) : field_(field), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        if (SearchStats* stats = current()) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+            stats->*field_ += elapsed.count();
+        }
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+}  // namespace instrument
+}  // namespace wallgo
+
+#define WALLGO_INSTRUMENT_CONCAT_(a, b) a##b
+#define WALLGO_INSTRUMENT_CONCAT(a, b) WALLGO_INSTRUMENT_CONCAT_(a, b)
+
+#define WALLGO_RECORD_SEARCH(stats) \
+    ::wallgo::instrument::Recording WALLGO_INSTRUMENT_CONCAT(wallgo_recording_, __LINE__)(stats)
+#define WALLGO_COUNT(field, n)                                                          \
+    do {                                                                                \
+        if (::wallgo::SearchStats* wallgo_stats_ = ::wallgo::instrument::current()) {   \
+            wallgo_stats_->field += (n);                                                \
+        }                                                                               \
+    } while (0)
+#define WALLGO_MAX(field, n)                                                            \
+    do {                                                                                \
+        if (::wallgo::SearchStats* wallgo_stats_ = ::wallgo::instrument::current()) {   \
+            wallgo_stats_->field = std::max(wallgo_stats_->field, (n));                 \
+        }                                                                               \
+    } while (0)
+#define WALLGO_PHASE(field) \
+    ::wallgo::instrument::PhaseTimer WALLGO_INSTRUMENT_CONCAT(wallgo_phase_, __LINE__)(&::wallgo::SearchStats::field)
+
+#else
+
+#define WALLGO_RECORD_SEARCH(stats) \
+    do {                            \
+    } while (0)
+#define WALLGO_COUNT(field, n) \
+    do {                       \
+    } while (0)
+#define WALLGO_MAX(field, n) \
+    do {                     \
+    } while (0)
+#define WALLGO_PHASE(field) \
+    do {                    \
+    } while (0)
+
+#endif  // WALLGO_INSTRUMENT
+
+#endif  // WALLGO_INSTRUMENTATION_H
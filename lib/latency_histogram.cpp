@@ -0,0 +1,66 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace wallgo {
+
+namespace {
+
+constexpr double MIN_SECONDS = 1e-6;
+
+}  // namespace
+
+int LatencyHistogram::bucket(double seconds) {
+    if (!(seconds > MIN_SECONDS)) return 0;
+    int index = static_cast<int>(std::log2(seconds / MIN_SECONDS) * SUB_BUCKETS);
+    return std::min(index, BUCKETS - 1);
+}
+
+double LatencyHistogram::midpoint(int bucket) {
+    return MIN_SECONDS * std::exp2((bucket + 0.5) / SUB_BUCKETS);
+}
+
+void LatencyHistogram::add(double seconds) {
+    ++counts_[bucket(seconds)];
+    ++count_;
+    sum_ += seconds;
+    max_ = std::max(max_, seconds);
+}
+
+void LatencyHistogram::add(const PlayerTiming& timing) {
+    for (const DecisionTime& decision : timing.decisions) {
+        add(decision.time);
+    }
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+    return *this;
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count_)));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) return std::min(midpoint(i), max_);
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::summary() const {
+    std::ostringstream out;
+    out << "n=" << count_ << " mean=" << mean() << "s p50=" << percentile(0.5) << "s p95=" << percentile(0.95)
+        << "s p99=" << percentile(0.99) << "s max=" << max_ << "s";
+    return out.str();
+}
+
+}  // namespace wallgo
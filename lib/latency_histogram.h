@@ -0,0 +1,51 @@
+#ifndef WALLGO_LATENCY_HISTOGRAM_H
+#define WALLGO_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+
+namespace wallgo {
+
+// Histogram of decision times with buckets on a log scale, eight per doubling from 1 microsecond to about 2 minutes.
+// Percentiles are reported as the middle of their bucket, within about 5% of the exact value. Histograms of different
+// games, players or threads can be merged, so a tournament can build one per strategy.
+class LatencyHistogram {
+   public:
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int OCTAVES = 27;
+    static constexpr int BUCKETS = SUB_BUCKETS * OCTAVES;
+
+   private:
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t count_ = 0;
+    double sum_ = 0;
+    double max_ = 0;
+
+    static int bucket(double seconds);
+    static double midpoint(int bucket);  // Geometric middle of the bucket
+
+   public:
+    void add(double seconds);
+
+    // Adds every decision of a player.
+    void add(const PlayerTiming& timing);
+
+    LatencyHistogram& operator+=(const LatencyHistogram& other);
+
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? sum_ / count_ : 0; }
+    double max() const { return max_; }
+
+    // Returns the time that a fraction p of the decisions took at most, e.g. p = 0.95 for p95. Returns 0 if empty.
+    double percentile(double p) const;
+
+    // Formats count, mean, p50, p95, p99 and max in one line.
+    std::string summary() const;
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_LATENCY_HISTOGRAM_H
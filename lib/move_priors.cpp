@@ -0,0 +1,133 @@
+#include "move_priors.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "cuts.h"
+#include "geometry.h"
+
+namespace wallgo {
+
+namespace {
+
+const char* CUT_NAMES[] = {"none", "near", "seal+", "seal0", "seal-"};
+const char* APPROACH_NAMES[] = {"closer", "same", "farther"};
+
+// Distance of cells that no opponent piece can reach.
+constexpr int FAR = 100;
+
+}  // namespace
+
+MoveFeatures::MoveFeatures(const Board& board, PlayerColor player)
+    : board_(board), player_(player), regions_(board) {
+    // Multi-source BFS from the opponent's pieces across edges without walls.
+    opponent_distance_.fill(FAR);
+    std::array<int, 49> queue;
+    int head = 0, tail = 0;
+    for (const Piece& piece : board.get_pieces(player == PlayerColor::Red ? PlayerColor::Blue : PlayerColor::Red)) {
+        int cell = piece.pos.r * 7 + piece.pos.c;
+        opponent_distance_[cell] = 0;
+        queue[tail++] = cell;
+    }
+    while (head < tail) {
+        int cell = queue[head++];
+        std::array<WallType, 4> walls = board.get({cell / 7, cell % 7}).walls();
+        for (int d = 0; d < 4; ++d) {
+            int next = Geometry<7>::neighbor[cell][d];
+            if (walls[d] != WallType::None || opponent_distance_[next] != FAR) continue;
+            opponent_distance_[next] = opponent_distance_[cell] + 1;
+            queue[tail++] = next;
+        }
+    }
+
+    for (const SealingMove& m : sealing_moves(board, player)) {
+        int8_t cut = m.kind == CutAnalysis::Kind::NearBridge ? 1 : m.gain > 0 ? 2 : m.gain == 0 ? 3 : 4;
+        cut_.emplace_back(PackedMove(m.move).bits(), cut);
+    }
+    std::sort(cut_.begin(), cut_.end());
+}
+
+int MoveFeatures::index(PackedMove move) const {
+    Position from = board_.get_piece(player_, move.piece_id()).pos;
+    Position to = from.move(move.direction1()).move(move.direction2());
+    int steps = move.direction1().has_value() + move.direction2().has_value();
+
+    std::optional<Piece> across = board_.get(to.move(move.wall_placement_direction())).piece();
+    int opponent = across && across->owner != player_;
+
+    auto found = std::lower_bound(cut_.begin(), cut_.end(), std::pair<uint16_t, int8_t>(move.bits(), INT8_MIN));
+    int cut = found != cut_.end() && found->first == move.bits() ? found->second : 0;
+
+    int locked = regions_.locked(from);
+
+    int before = opponent_distance_[from.r * 7 + from.c], after = opponent_distance_[to.r * 7 + to.c];
+    int approach = after < before ? 0 : after == before ? 1 : 2;
+
+    std::array<WallType, 4> around = board_.get(to).walls();
+    int walls = static_cast<int>(
+        std::count_if(around.begin(), around.end(), [](WallType w) { return w != WallType::None; }));
+
+    return ((((steps * 2 + opponent) * 5 + cut) * 2 + locked) * 3 + approach) * 4 + std::min(walls, 3);
+}
+
+std::string MoveFeatures::describe(int index) {
+    int walls = index % 4, approach = index / 4 % 3, locked = index / 12 % 2, cut = index / 24 % 5,
+        opponent = index / 120 % 2, steps = index / 240;
+    std::ostringstream out;
+    out << "steps=" << steps << " opponent=" << opponent << " cut=" << CUT_NAMES[cut] << " locked=" << locked
+        << " approach=" << APPROACH_NAMES[approach] << " walls=" << walls;
+    return out.str();
+}
+
+MovePriors read_move_priors(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    std::string magic;
+    int version;
+    if (!(in >> magic >> version) || magic != "wallgo-move-priors" || version != 1) {
+        throw std::runtime_error(path + " is not a move prior table");
+    }
+    MovePriors priors;
+    for (float& prior : priors.prior) {
+        if (!(in >> prior)) throw std::runtime_error(path + " is truncated");
+    }
+    return priors;
+}
+
+void write_move_priors(const std::string& path, const MovePriors& priors) {
+    std::ofstream out(path);
+    out.precision(6);
+    out << "wallgo-move-priors 1\n";
+    for (float prior : priors.prior) {
+        out << prior << "\n";
+    }
+    if (!out.flush()) throw std::runtime_error("Cannot write " + path);
+}
+
+void sort_by_prior(const Board& board, PlayerColor player, const MovePriors& priors, std::vector<PackedMove>& moves) {
+    MoveFeatures features(board, player);
+    std::vector<std::pair<float, PackedMove>> keyed;
+    keyed.reserve(moves.size());
+    for (PackedMove move : moves) {
+        keyed.emplace_back(priors.prior[features.index(move)], move);
+    }
+    std::stable_sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = 0; i < moves.size(); ++i) {
+        moves[i] = keyed[i].second;
+    }
+}
+
+std::vector<Move> ordered_moves(const Board& board, PlayerColor player, const MovePriors& priors) {
+    std::vector<PackedMove> packed = board.get_packed_moves(player);
+    sort_by_prior(board, player, priors, packed);
+    std::vector<Move> moves;
+    moves.reserve(packed.size());
+    for (PackedMove move : packed) {
+        moves.push_back(move.unpack());
+    }
+    return moves;
+}
+
+}  // namespace wallgo
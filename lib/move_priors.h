@@ -0,0 +1,66 @@
+#ifndef WALLGO_MOVE_PRIORS_H
+#define WALLGO_MOVE_PRIORS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "regions.h"
+#include "types.h"
+
+namespace wallgo {
+
+// Cheap features of the moves of one position, combined into a single index per move:
+//   steps      0, 1 or 2
+//   opponent   whether the wall is placed next to an opponent piece, on the far side of the edge
+//   cut        what the wall does to its region (see cuts.h): nothing, wall a near-bridge, or wall a bridge that seals
+//              more cells for the mover than for the opponent, as many, or fewer
+//   locked     whether the piece is already sealed off from all opponents (see RegionMap::locked)
+//   approach   whether the piece ends closer to the nearest opponent piece than it started, as far, or farther,
+//              counting steps around walls but through pieces
+//   walls      walls and border already around the cell the piece ends on, 0 to 3
+class MoveFeatures {
+   public:
+    static constexpr int COUNT = 3 * 2 * 5 * 2 * 3 * 4;
+
+   private:
+    const Board& board_;
+    PlayerColor player_;
+    RegionMap regions_;
+    std::array<int, 49> opponent_distance_;
+    std::vector<std::pair<uint16_t, int8_t>> cut_;  // Cut feature of the moves that wall a cut, by PackedMove bits
+
+   public:
+    // Analyzes board for moves of player. The board must outlive the features.
+    MoveFeatures(const Board& board, PlayerColor player);
+
+    // Index of a legal move of player, below COUNT.
+    int index(PackedMove move) const;
+    int index(const Move& move) const { return index(PackedMove(move)); }
+
+    // The features an index stands for, e.g. "steps=1 opponent=0 cut=seal+ locked=0 approach=closer walls=2".
+    static std::string describe(int index);
+};
+
+// How much likelier than average a move with each combination of features is to be played, as the natural log of the
+// ratio, mined from recorded games by priors.exe. Search can try moves with higher priors first.
+struct MovePriors {
+    std::array<float, MoveFeatures::COUNT> prior = {};
+};
+
+// Reads and writes priors as text: a "wallgo-move-priors 1" line, then one prior per feature index. read_move_priors
+// throws std::runtime_error if the file is missing or malformed.
+MovePriors read_move_priors(const std::string& path);
+void write_move_priors(const std::string& path, const MovePriors& priors);
+
+// Sorts moves of player, the side to act on board, by prior, highest first. Moves with equal priors keep their order.
+void sort_by_prior(const Board& board, PlayerColor player, const MovePriors& priors, std::vector<PackedMove>& moves);
+
+// The legal moves of player sorted by prior, as a move generator for search that wants the likely moves first.
+std::vector<Move> ordered_moves(const Board& board, PlayerColor player, const MovePriors& priors);
+
+}  // namespace wallgo
+
+#endif  // WALLGO_MOVE_PRIORS_H
@@ -0,0 +1,280 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WALLGO_X86 1
+#include <immintrin.h>
+#endif
+
+namespace wallgo {
+namespace nnue {
+
+namespace {
+
+constexpr char MAGIC[8] = {'W', 'G', 'N', 'N', 'U', 'E', '0', '1'};
+
+using Column = std::array<int16_t, ACCUMULATOR>;
+
+// Plain C++ versions, also the reference for the SIMD ones.
+namespace scalar {
+
+void add(Column& accumulator, const Column& column) {
+    for (int i = 0; i < ACCUMULATOR; ++i) {
+        accumulator[i] += column[i];
+    }
+}
+
+void sub(Column& accumulator, const Column& column) {
+    for (int i = 0; i < ACCUMULATOR; ++i) {
+        accumulator[i] -= column[i];
+    }
+}
+
+int32_t forward(const Column& mine, const Column& theirs, const Weights& weights) {
+    std::array<uint8_t, 2 * ACCUMULATOR> inputs;
+    for (int i = 0; i < ACCUMULATOR; ++i) {
+        inputs[i] = static_cast<uint8_t>(std::clamp<int>(mine[i], 0, 127));
+        inputs[ACCUMULATOR + i] = static_cast<uint8_t>(std::clamp<int>(theirs[i], 0, 127));
+    }
+    int32_t output = weights.output_bias;
+    for (int j = 0; j < HIDDEN; ++j) {
+        int32_t sum = weights.hidden_bias[j];
+        for (int i = 0; i < 2 * ACCUMULATOR; ++i) {
+            sum += inputs[i] * weights.hidden_weights[j][i];
+        }
+        output += std::clamp(sum >> HIDDEN_SHIFT, 0, 127) * weights.output_weights[j];
+    }
+    return output;
+}
+
+}  // namespace scalar
+
+#ifdef WALLGO_X86
+
+#define WALLGO_AVX2 __attribute__((target("avx2")))
+
+namespace avx2 {
+
+WALLGO_AVX2 void add(Column& accumulator, const Column& column) {
+    for (int i = 0; i < ACCUMULATOR; i += 16) {
+        __m256i* a = reinterpret_cast<__m256i*>(&accumulator[i]);
+        __m256i c = _mm256_load_si256(reinterpret_cast<const __m256i*>(&column[i]));
+        _mm256_store_si256(a, _mm256_add_epi16(_mm256_load_si256(a), c));
+    }
+}
+
+WALLGO_AVX2 void sub(Column& accumulator, const Column& column) {
+    for (int i = 0; i < ACCUMULATOR; i += 16) {
+        __m256i* a = reinterpret_cast<__m256i*>(&accumulator[i]);
+        __m256i c = _mm256_load_si256(reinterpret_cast<const __m256i*>(&column[i]));
+        _mm256_store_si256(a, _mm256_sub_epi16(_mm256_load_si256(a), c));
+    }
+}
+
+// Clamps 32 accumulator values starting at p to [0, 127] bytes, in order.
+WALLGO_AVX2 __m256i clamp_32(const int16_t* p) {
+    __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(p + 16));
+    // packus interleaves the 128-bit lanes of its operands; put them back in order.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0b11011000);
+    return _mm256_min_epu8(packed, _mm256_set1_epi8(127));
+}
+
+WALLGO_AVX2 int32_t horizontal_sum(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+    return _mm_cvtsi128_si32(sum);
+}
+
+WALLGO_AVX2 int32_t forward(const Column& mine, const Column& theirs, const Weights& weights) {
+    static_assert(ACCUMULATOR == 64, "The inputs are loaded as four blocks of 32 bytes");
+    const __m256i inputs[4] = {clamp_32(&mine[0]), clamp_32(&mine[32]), clamp_32(&theirs[0]),
+                               clamp_32(&theirs[32])};
+    const __m256i ones = _mm256_set1_epi16(1);
+    int32_t output = weights.output_bias;
+    for (int j = 0; j < HIDDEN; ++j) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int block = 0; block < 4; ++block) {
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(&weights.hidden_weights[j][32 * block]));
+            // Inputs are at most 127 and weights at least -128, so the pairwise sums fit in 16 bits.
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(inputs[block], w), ones));
+        }
+        int32_t hidden = weights.hidden_bias[j] + horizontal_sum(sum);
+        output += std::clamp(hidden >> HIDDEN_SHIFT, 0, 127) * weights.output_weights[j];
+    }
+    return output;
+}
+
+}  // namespace avx2
+
+#endif  // WALLGO_X86
+
+struct Implementation {
+    const char* name;
+    void (*add)(Column&, const Column&);
+    void (*sub)(Column&, const Column&);
+    int32_t (*forward)(const Column&, const Column&, const Weights&);
+};
+
+Implementation choose() {
+#ifdef WALLGO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", avx2::add, avx2::sub, avx2::forward};
+    }
+#endif
+    return {"scalar", scalar::add, scalar::sub, scalar::forward};
+}
+
+const Implementation& implementation() {
+    static const Implementation chosen = choose();
+    return chosen;
+}
+
+int perspective_index(PlayerColor perspective) { return perspective == PlayerColor::Red ? 0 : 1; }
+
+}  // namespace
+
+int piece_feature(PlayerColor perspective, PlayerColor owner, int cell) {
+    return (owner == perspective ? 0 : CELLS) + cell;
+}
+
+int wall_feature(PlayerColor perspective, PlayerColor owner, int edge) {
+    return 2 * CELLS + (owner == perspective ? 0 : zobrist::EDGE_COUNT) + edge;
+}
+
+Network::Network(std::shared_ptr<const Weights> weights) : weights_(std::move(weights)) {}
+
+Network Network::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open " + path);
+    char magic[8];
+    uint32_t dimensions[3];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions));
+    if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a network file");
+    }
+    if (dimensions[0] != INPUTS || dimensions[1] != ACCUMULATOR || dimensions[2] != HIDDEN) {
+        throw std::runtime_error(path + " has different dimensions than this build");
+    }
+
+    auto weights = std::make_shared<Weights>();
+    auto read = [&](auto& field) { in.read(reinterpret_cast<char*>(&field), sizeof(field)); };
+    read(weights->output_scale);
+    read(weights->feature_bias);
+    read(weights->feature_weights);
+    read(weights->hidden_bias);
+    read(weights->hidden_weights);
+    read(weights->output_bias);
+    read(weights->output_weights);
+    if (!in) throw std::runtime_error(path + " is truncated");
+    return Network(std::move(weights));
+}
+
+Network Network::random(uint32_t seed) {
+    std::mt19937 rng(seed);
+    auto uniform = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); };
+    auto weights = std::make_shared<Weights>();
+    for (auto& bias : weights->feature_bias) bias = uniform(0, 32);
+    for (auto& column : weights->feature_weights) {
+        for (auto& weight : column) weight = uniform(-32, 32);
+    }
+    for (auto& bias : weights->hidden_bias) bias = uniform(-512, 512);
+    for (auto& row : weights->hidden_weights) {
+        for (auto& weight : row) weight = uniform(-64, 64);
+    }
+    weights->output_bias = 0;
+    for (auto& weight : weights->output_weights) weight = uniform(-64, 64);
+    weights->output_scale = 1.0f / 1024;
+    return Network(std::move(weights));
+}
+
+void Network::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    uint32_t dimensions[3] = {INPUTS, ACCUMULATOR, HIDDEN};
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+    auto write = [&](const auto& field) { out.write(reinterpret_cast<const char*>(&field), sizeof(field)); };
+    const Weights& weights = *weights_;
+    write(weights.output_scale);
+    write(weights.feature_bias);
+    write(weights.feature_weights);
+    write(weights.hidden_bias);
+    write(weights.hidden_weights);
+    write(weights.output_bias);
+    write(weights.output_weights);
+    if (!out.flush()) throw std::runtime_error("Cannot write " + path);
+}
+
+// Adds (sign 1) or removes (sign -1) the feature of a piece on cell, or of a wall on edge if cell is -1, in both
+// perspectives.
+void Network::add_feature(Accumulator& accumulator, PlayerColor owner, int cell, int edge, int sign) const {
+    const Implementation& impl = implementation();
+    for (PlayerColor perspective : {PlayerColor::Red, PlayerColor::Blue}) {
+        int feature = cell >= 0 ? piece_feature(perspective, owner, cell) : wall_feature(perspective, owner, edge);
+        Column& values = accumulator.values[perspective_index(perspective)];
+        (sign > 0 ? impl.add : impl.sub)(values, weights_->feature_weights[feature]);
+    }
+}
+
+void Network::refresh(const Board& board, Accumulator& accumulator) const {
+    accumulator.values[0] = weights_->feature_bias;
+    accumulator.values[1] = weights_->feature_bias;
+    for (int r = 0; r < 7; ++r) {
+        for (int c = 0; c < 7; ++c) {
+            Position pos{r, c};
+            const Cell& cell = board.get(pos);
+            if (auto piece = cell.piece()) {
+                add_feature(accumulator, piece->owner, r * 7 + c, -1, 1);
+            }
+            // Each interior edge is seen from the cell above or to its left.
+            for (Direction d : {Direction::Right, Direction::Down}) {
+                WallType wall = cell.wall(d);
+                int edge = zobrist::edge_index(pos, d);
+                if (edge < 0 || (wall != WallType::PlayerRed && wall != WallType::PlayerBlue)) continue;
+                PlayerColor owner = wall == WallType::PlayerRed ? PlayerColor::Red : PlayerColor::Blue;
+                add_feature(accumulator, owner, -1, edge, 1);
+            }
+        }
+    }
+}
+
+void Network::apply(const Board& board, const Move& move, Accumulator& accumulator) const {
+    Position from = board.get_piece(move.player(), move.piece_id()).pos;
+    Position to = from.move(move.direction1()).move(move.direction2());
+    if (!(from == to)) {
+        add_feature(accumulator, move.player(), from.r * 7 + from.c, -1, -1);
+        add_feature(accumulator, move.player(), to.r * 7 + to.c, -1, 1);
+    }
+    add_feature(accumulator, move.player(), -1, zobrist::edge_index(to, move.wall_placement_direction()), 1);
+}
+
+void Network::undo(const Board& board, const Move& move, Accumulator& accumulator) const {
+    Position from = board.get_piece(move.player(), move.piece_id()).pos;
+    Position to = from.move(move.direction1()).move(move.direction2());
+    add_feature(accumulator, move.player(), -1, zobrist::edge_index(to, move.wall_placement_direction()), -1);
+    if (!(from == to)) {
+        add_feature(accumulator, move.player(), to.r * 7 + to.c, -1, -1);
+        add_feature(accumulator, move.player(), from.r * 7 + from.c, -1, 1);
+    }
+}
+
+double Network::evaluate(const Accumulator& accumulator, PlayerColor player) const {
+    const Implementation& impl = implementation();
+    const Column& mine = accumulator.values[perspective_index(player)];
+    const Column& theirs = accumulator.values[1 - perspective_index(player)];
+    int32_t output = impl.forward(mine, theirs, *weights_) - impl.forward(theirs, mine, *weights_);
+    return output * (0.5 * weights_->output_scale);
+}
+
+const char* isa() { return implementation().name; }
+
+}  // namespace nnue
+}  // namespace wallgo
@@ -0,0 +1,98 @@
+#ifndef WALLGO_NNUE_H
+#define WALLGO_NNUE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "types.h"
+#include "zobrist.h"
+
+namespace wallgo {
+
+// Efficiently updatable evaluation network.
+//
+// The inputs are sparse binary features seen from one player's perspective: a piece of mine or of the opponent on
+// each cell, and a wall placed by me or by the opponent on each interior edge. The first layer sums the int16 weight
+// columns of the active features into an accumulator, one per perspective. A move moves one piece and adds one wall,
+// so it changes at most three features and the accumulators are updated by adding and subtracting three columns
+// instead of being recomputed.
+//
+// The evaluation from a player's view clamps its accumulator and the opponent's to [0, 127], concatenates them into
+// 128 int8 inputs, and runs them through a hidden layer of HIDDEN clipped ReLU units and a linear output, in integer
+// arithmetic. As in eval_kernels.h, AVX2 is used if the CPU supports it, and all versions give identical results.
+namespace nnue {
+
+constexpr int CELLS = 49;
+constexpr int INPUTS = 2 * CELLS + 2 * zobrist::EDGE_COUNT;
+constexpr int ACCUMULATOR = 64;
+constexpr int HIDDEN = 16;
+
+// Input feature of a piece of owner on cell (r * 7 + c), from perspective's view.
+int piece_feature(PlayerColor perspective, PlayerColor owner, int cell);
+
+// Input feature of a wall placed by owner on an interior edge (see zobrist::edge_index), from perspective's view.
+int wall_feature(PlayerColor perspective, PlayerColor owner, int edge);
+
+struct alignas(32) Accumulator {
+    std::array<std::array<int16_t, ACCUMULATOR>, 2> values;  // Indexed by perspective: Red, then Blue
+};
+
+// Quantized weights. Stored in files in this order, in host byte order and without padding, after a header of the
+// magic "WGNNUE01", the uint32 dimensions INPUTS, ACCUMULATOR and HIDDEN, and the float output scale.
+struct alignas(32) Weights {
+    std::array<int16_t, ACCUMULATOR> feature_bias;
+    std::array<std::array<int16_t, ACCUMULATOR>, INPUTS> feature_weights;
+    std::array<int32_t, HIDDEN> hidden_bias;
+    std::array<std::array<int8_t, 2 * ACCUMULATOR>, HIDDEN> hidden_weights;  // Mine, then theirs
+    int32_t output_bias;
+    std::array<int8_t, HIDDEN> output_weights;
+    float output_scale;  // Converts the integer output to cells
+};
+
+// Number of bits the hidden layer's sums are shifted right by before clamping.
+constexpr int HIDDEN_SHIFT = 6;
+
+class Network {
+   private:
+    std::shared_ptr<const Weights> weights_;
+
+    void add_feature(Accumulator& accumulator, PlayerColor owner, int cell, int edge, int sign) const;
+
+   public:
+    explicit Network(std::shared_ptr<const Weights> weights);
+
+    // Reads a network from a file. Throws std::runtime_error if it is missing or does not match the dimensions.
+    static Network load(const std::string& path);
+
+    // Small random weights, for tests and as a starting point for training.
+    static Network random(uint32_t seed);
+
+    // Writes the network in the format load reads. Throws std::runtime_error on failure.
+    void save(const std::string& path) const;
+
+    const Weights& weights() const { return *weights_; }
+
+    // Computes the accumulators of board from scratch.
+    void refresh(const Board& board, Accumulator& accumulator) const;
+
+    // Updates the accumulators of board, the position before move, to the position after it.
+    void apply(const Board& board, const Move& move, Accumulator& accumulator) const;
+
+    // Reverses apply: updates the accumulators of the position after move back to board, the position before it.
+    void undo(const Board& board, const Move& move, Accumulator& accumulator) const;
+
+    // Returns the score from player's point of view, in cells: half the difference between the outputs of the network
+    // from player's view and from the opponent's, so that the scores of both players sum to zero.
+    double evaluate(const Accumulator& accumulator, PlayerColor player) const;
+};
+
+// Name of the instruction set in use: "avx2" or "scalar".
+const char* isa();
+
+}  // namespace nnue
+
+}  // namespace wallgo
+
+#endif  // WALLGO_NNUE_H
@@ -0,0 +1,280 @@
+#include "placement.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+
+#include "instrumentation.h"
+
+namespace wallgo {
+
+namespace {
+
+constexpr uint64_t ALL = (1ULL << 49) - 1;
+constexpr uint64_t COLUMN_0 = 0x0040810204081ULL;  // Bits 0, 7, ..., 42
+constexpr uint64_t COLUMN_6 = COLUMN_0 << 6;
+constexpr PlayerColor ORDER[8] = {PlayerColor::Red,  PlayerColor::Blue, PlayerColor::Blue, PlayerColor::Red,
+                                  PlayerColor::Red,  PlayerColor::Blue, PlayerColor::Blue, PlayerColor::Red};
+constexpr int WIN = 1000;  // Beyond any score
+constexpr uint64_t CHECK_EVERY = 1024;  // Positions between looks at the clock
+
+// Where each of the 8 rotations and reflections of the board sends each cell. The first is the identity.
+constexpr std::array<std::array<int8_t, 49>, 8> SYMMETRY = [] {
+    std::array<std::array<int8_t, 49>, 8> map{};
+    for (int r = 0; r < 7; ++r) {
+        for (int c = 0; c < 7; ++c) {
+            int to[8][2] = {{r, c},     {c, 6 - r}, {6 - r, 6 - c}, {6 - c, r},
+                            {r, 6 - c}, {6 - r, c}, {c, r},         {6 - c, 6 - r}};
+            for (int s = 0; s < 8; ++s) map[s][r * 7 + c] = static_cast<int8_t>(to[s][0] * 7 + to[s][1]);
+        }
+    }
+    return map;
+}();
+
+uint64_t transform(uint64_t cells, int s) {
+    uint64_t result = 0;
+    for (; cells; cells &= cells - 1) result |= 1ULL << SYMMETRY[s][std::countr_zero(cells)];
+    return result;
+}
+
+// The cells next to any of cells.
+uint64_t spread(uint64_t cells) {
+    return ((cells << 7) | (cells >> 7) | ((cells << 1) & ~COLUMN_0) | ((cells >> 1) & ~COLUMN_6)) & ALL;
+}
+
+// Red's cells minus Blue's: each color's pieces, and the empty cells its pieces reach first. Both colors flood one step
+// at a time through empty cells; a cell both reach in the same step counts for nobody.
+int voronoi(uint64_t red, uint64_t blue) {
+    uint64_t empty = ALL & ~(red | blue);
+    uint64_t seen_red = red, seen_blue = blue, front_red = red, front_blue = blue;
+    int score = std::popcount(red) - std::popcount(blue);
+    while (front_red | front_blue) {
+        front_red = spread(front_red) & empty & ~seen_red;
+        front_blue = spread(front_blue) & empty & ~seen_blue;
+        score += std::popcount(front_red & ~seen_blue & ~front_blue) -
+                 std::popcount(front_blue & ~seen_red & ~front_red);
+        seen_red |= front_red;
+        seen_blue |= front_blue;
+    }
+    return score;
+}
+
+// Symmetries other than the identity that map the pieces of both colors onto themselves, as a bit mask.
+int stabilizer(uint64_t red, uint64_t blue) {
+    int symmetries = 0;
+    for (int s = 1; s < 8; ++s) {
+        if (transform(red, s) == red && transform(blue, s) == blue) symmetries |= 1 << s;
+    }
+    return symmetries;
+}
+
+// Whether no symmetry in symmetries sends cell to a lower cell that is also in allowed.
+bool canonical(int cell, int symmetries, uint64_t allowed) {
+    for (; symmetries; symmetries &= symmetries - 1) {
+        int other = SYMMETRY[std::countr_zero(static_cast<unsigned>(symmetries))][cell];
+        if (other < cell && (allowed >> other & 1)) return false;
+    }
+    return true;
+}
+
+class Searcher {
+   private:
+    std::atomic<bool>& stop_;
+    bool timed_;
+    std::chrono::steady_clock::time_point deadline_;
+    uint64_t next_check_ = CHECK_EVERY;
+
+   public:
+    uint64_t nodes = 0;
+
+    Searcher(std::atomic<bool>& stop, bool timed, std::chrono::steady_clock::time_point deadline)
+        : stop_(stop), timed_(timed), deadline_(deadline) {}
+
+    // Cells to try for placement ply: one of each orbit under the position's symmetries, or, for the second of two
+    // placements in a row by one player, the cells after the first one's.
+    static int candidates(uint64_t red, uint64_t blue, int after, std::array<int8_t, 49>& cells) {
+        uint64_t empty = ALL & ~(red | blue);
+        int count = 0;
+        if (after >= 0) {
+            for (uint64_t rest = empty & ~((2ULL << after) - 1); rest; rest &= rest - 1) {
+                cells[count++] = static_cast<int8_t>(std::countr_zero(rest));
+            }
+            return count;
+        }
+        int symmetries = stabilizer(red, blue);
+        for (uint64_t rest = empty; rest; rest &= rest - 1) {
+            int cell = std::countr_zero(rest);
+            if (canonical(cell, symmetries, empty)) cells[count++] = static_cast<int8_t>(cell);
+        }
+        return count;
+    }
+
+    // Minimax value of the position before placement ply, looking depth placements ahead, with Red maximizing. after
+    // is the cell of the previous placement if it was the first of two in a row by one player, otherwise -1.
+    int minimax(uint64_t red, uint64_t blue, int ply, int depth, int alpha, int beta, int after) {
+        if (depth == 0 || ply == 8) {
+            ++nodes;
+            return voronoi(red, blue);
+        }
+        if (timed_ && nodes >= next_check_) {
+            next_check_ = nodes + CHECK_EVERY;
+            if (std::chrono::steady_clock::now() > deadline_) stop_ = true;
+        }
+        if (stop_.load(std::memory_order_relaxed)) return 0;
+        bool maximizing = ORDER[ply] == PlayerColor::Red;
+        bool pair = ply + 1 < 8 && ORDER[ply + 1] == ORDER[ply];
+
+        std::array<int8_t, 49> cells;
+        int count = candidates(red, blue, after, cells);
+        if (depth >= 2) {
+            // Try the cells that score best right away first.
+            std::array<std::pair<int, int8_t>, 49> keyed;
+            for (int i = 0; i < count; ++i) {
+                uint64_t bit = 1ULL << cells[i];
+                int score = maximizing ? voronoi(red | bit, blue) : -voronoi(red, blue | bit);
+                keyed[i] = {-score, cells[i]};
+            }
+            nodes += count;
+            std::sort(keyed.begin(), keyed.begin() + count);
+            for (int i = 0; i < count; ++i) cells[i] = keyed[i].second;
+        }
+
+        int best = maximizing ? -WIN : WIN;
+        for (int i = 0; i < count; ++i) {
+            uint64_t bit = 1ULL << cells[i];
+            int next_after = pair ? cells[i] : -1;
+            int value = maximizing ? minimax(red | bit, blue, ply + 1, depth - 1, alpha, beta, next_after)
+                                   : minimax(red, blue | bit, ply + 1, depth - 1, alpha, beta, next_after);
+            if (stop_.load(std::memory_order_relaxed)) return 0;
+            if (maximizing) {
+                best = std::max(best, value);
+                alpha = std::max(alpha, best);
+            } else {
+                best = std::min(best, value);
+                beta = std::min(beta, best);
+            }
+            if (alpha >= beta) break;
+        }
+        return best;
+    }
+};
+
+}  // namespace
+
+PlacementSearch::PlacementSearch(int threads) {
+    for (int i = 1; i < threads; ++i) {
+        threads_.emplace_back([this] { run(); });
+    }
+}
+
+PlacementSearch::~PlacementSearch() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+}
+
+void PlacementSearch::run() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        changed_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) return;
+        seen = generation_;
+        lock.unlock();
+        job_();
+        lock.lock();
+        if (--running_ == 0) changed_.notify_all();
+    }
+}
+
+void PlacementSearch::run_on_all(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = std::move(job);
+        running_ = static_cast<int>(threads_.size());
+        ++generation_;
+    }
+    changed_.notify_all();
+    job_();
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&] { return running_ == 0; });
+}
+
+PlacementResult PlacementSearch::search(const Board& board, const std::vector<Position>& valid_positions,
+                                        double seconds, int max_depth) {
+    if (valid_positions.empty()) throw std::invalid_argument("No valid positions to place on");
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(seconds));
+
+    uint64_t red = 0, blue = 0, allowed = 0;
+    for (const Piece& piece : board.get_pieces(PlayerColor::Red)) red |= 1ULL << (piece.pos.r * 7 + piece.pos.c);
+    for (const Piece& piece : board.get_pieces(PlayerColor::Blue)) blue |= 1ULL << (piece.pos.r * 7 + piece.pos.c);
+    for (const Position& pos : valid_positions) allowed |= 1ULL << (pos.r * 7 + pos.c);
+    int ply = std::popcount(red | blue);
+    if (ply >= 8) throw std::invalid_argument("All pieces are placed");
+    bool maximizing = ORDER[ply] == PlayerColor::Red;
+    bool pair = ply + 1 < 8 && ORDER[ply + 1] == ORDER[ply];
+
+    // Root cells, each with its value from the last completed iteration, best first.
+    int symmetries = stabilizer(red, blue);
+    std::vector<std::pair<int, int>> root;
+    for (uint64_t rest = allowed; rest; rest &= rest - 1) {
+        int cell = std::countr_zero(rest);
+        if (canonical(cell, symmetries, allowed)) root.emplace_back(0, cell);
+    }
+
+    int last = 8 - ply;
+    if (max_depth > 0) last = std::min(last, max_depth);
+    PlacementResult result{{root[0].second / 7, root[0].second % 7}, 0, 0, 0};
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> nodes = 0;
+    for (int depth = 1; depth <= last; ++depth) {
+        // The first iteration always completes, so there is a result however short the time.
+        bool timed = max_depth == 0 && depth > 1;
+        if (timed && std::chrono::steady_clock::now() - start > (deadline - start) / 2) break;
+
+        std::vector<int> values(root.size());
+        std::atomic<size_t> next = 0;
+        std::atomic<int> bound = maximizing ? -WIN : WIN;
+        run_on_all([&] {
+            Searcher searcher(stop, timed, deadline);
+            for (size_t i; (i = next++) < root.size() && !stop;) {
+                int cell = root[i].second;
+                uint64_t bit = 1ULL << cell;
+                int next_after = pair ? cell : -1;
+                // Windows open one below the best value found so far, so that every cell that ties it gets an exact
+                // value and the choice among them does not depend on which thread finished first.
+                int value;
+                if (maximizing) {
+                    value = searcher.minimax(red | bit, blue, ply + 1, depth - 1, bound - 1, WIN, next_after);
+                    for (int seen = bound; value > seen && !bound.compare_exchange_weak(seen, value);) {
+                    }
+                } else {
+                    value = searcher.minimax(red, blue | bit, ply + 1, depth - 1, -WIN, bound + 1, next_after);
+                    for (int seen = bound; value < seen && !bound.compare_exchange_weak(seen, value);) {
+                    }
+                }
+                values[i] = value;
+            }
+            nodes += searcher.nodes;
+        });
+        if (stop) break;
+
+        for (size_t i = 0; i < root.size(); ++i) root[i].first = maximizing ? -values[i] : values[i];
+        std::stable_sort(root.begin(), root.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        result.best = {root[0].second / 7, root[0].second % 7};
+        result.score = maximizing ? -root[0].first : root[0].first;
+        result.depth = depth;
+    }
+    result.nodes = nodes;
+    WALLGO_COUNT(evaluations, result.nodes);
+    WALLGO_MAX(depth, result.depth);
+    return result;
+}
+
+}  // namespace wallgo
@@ -0,0 +1,67 @@
+#ifndef WALLGO_PLACEMENT_H
+#define WALLGO_PLACEMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+struct PlacementResult {
+    Position best;
+    int score;       // Red's Voronoi cells minus Blue's at the end of the deepest completed lookahead
+    int depth;       // Placements looked ahead, counting this one
+    uint64_t nodes;  // Positions scored
+};
+
+// Chooses where to place pieces by looking ahead over the rest of the placement order, RBBRRBBR, with both players
+// maximizing their Voronoi territory: the empty cells that their pieces reach in fewer steps than the opponent's,
+// moving around other pieces. Pieces are kept as two 49-bit masks and distances are flooded a whole step at a time, so
+// a position costs a few dozen word operations instead of a BFS per piece.
+//
+// Lookahead is iteratively deepened minimax with alpha-beta. Positions are pruned by symmetry: if a rotation or
+// reflection of the board maps the pieces of both colors onto themselves, only one cell of each orbit is tried. When a
+// player places two pieces in a row, the second goes on a later cell than the first, so each pair is searched once. The
+// cells of the position to decide are shared among a pool of threads that is started once and reused for every
+// placement; threads raise a shared bound as their cells finish.
+//
+// During placement the board has no walls; search ignores any.
+class PlacementSearch {
+   private:
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::function<void()> job_;
+    uint64_t generation_ = 0;  // Incremented for every job handed to the pool
+    int running_ = 0;          // Threads still working on the current job
+    bool stopping_ = false;
+
+    void run();
+    void run_on_all(std::function<void()> job);
+
+   public:
+    // threads includes the calling thread, which works on every search too.
+    explicit PlacementSearch(int threads = std::max(1u, std::thread::hardware_concurrency()));
+    ~PlacementSearch();
+
+    PlacementSearch(const PlacementSearch&) = delete;
+    PlacementSearch& operator=(const PlacementSearch&) = delete;
+
+    // Picks one of valid_positions for the next piece in the placement order, which is inferred from the number of
+    // pieces on board. Deepens until seconds have passed, or, if max_depth is nonzero, to max_depth placements
+    // regardless of time, for reproducible results. To have placement cost no clock time, pass a little less than the
+    // time control's grace, e.g. 0.08 seconds with the default grace of 0.1.
+    PlacementResult search(const Board& board, const std::vector<Position>& valid_positions, double seconds,
+                           int max_depth = 0);
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_PLACEMENT_H
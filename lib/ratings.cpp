@@ -0,0 +1,97 @@
+#include "ratings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace wallgo {
+
+namespace {
+
+// Elo per unit of natural log of gamma.
+const double ELO_PER_NEPER = 400 / std::log(10.0);
+
+}  // namespace
+
+RatingTable::RatingTable(int players, double prior)
+    : players_(players), prior_(prior), wins_(static_cast<size_t>(players) * players, 0), gamma_(players, 1) {
+    if (players < 1 || prior <= 0) {
+        throw std::invalid_argument("A rating table needs players and a positive prior");
+    }
+}
+
+void RatingTable::add_game(int winner, int loser) { ++wins_[winner * players_ + loser]; }
+
+void RatingTable::update(int iterations, double tolerance) {
+    std::vector<double> next(players_);
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        for (int i = 0; i < players_; ++i) {
+            double won = prior_;
+            double denominator = 2 * prior_ / (gamma_[i] + 1);  // The virtual games against a player with gamma 1
+            for (int j = 0; j < players_; ++j) {
+                if (j == i) continue;
+                won += wins(i, j);
+                uint64_t games = wins(i, j) + wins(j, i);
+                if (games) denominator += games / (gamma_[i] + gamma_[j]);
+            }
+            next[i] = won / denominator;
+        }
+        double moved = 0;
+        for (int i = 0; i < players_; ++i) {
+            moved = std::max(moved, std::abs(std::log(next[i] / gamma_[i])) * ELO_PER_NEPER);
+        }
+        gamma_.swap(next);
+        if (moved < tolerance) break;
+    }
+}
+
+std::vector<RatingTable::Rating> RatingTable::ratings() const {
+    std::vector<Rating> result(players_);
+    double mean = 0;
+    for (int i = 0; i < players_; ++i) {
+        mean += std::log(gamma_[i]) * ELO_PER_NEPER / players_;
+    }
+    for (int i = 0; i < players_; ++i) {
+        // Fisher information of log gamma_i, including the virtual games.
+        double p = gamma_[i] / (gamma_[i] + 1);
+        double information = 2 * prior_ * p * (1 - p);
+        uint64_t games = 0, won = 0;
+        for (int j = 0; j < players_; ++j) {
+            if (j == i) continue;
+            uint64_t n = wins(i, j) + wins(j, i);
+            p = gamma_[i] / (gamma_[i] + gamma_[j]);
+            information += n * p * (1 - p);
+            games += n;
+            won += wins(i, j);
+        }
+        result[i] = {std::log(gamma_[i]) * ELO_PER_NEPER - mean, 1.96 * ELO_PER_NEPER / std::sqrt(information), games,
+                     games ? static_cast<double>(won) / games : 0};
+    }
+    return result;
+}
+
+std::string RatingTable::format(const std::vector<std::string>& names) const {
+    std::vector<Rating> table = ratings();
+    std::vector<int> order(players_);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return table[a].elo > table[b].elo; });
+    size_t width = 4;
+    for (const std::string& name : names) width = std::max(width, name.size());
+
+    std::ostringstream out;
+    out << std::fixed << std::left << std::setw(5) << "rank" << std::setw(width + 2) << "name" << std::right
+        << std::setw(7) << "elo" << std::setw(7) << "+-" << std::setw(8) << "games" << std::setw(8) << "score"
+        << "\n";
+    for (int rank = 0; rank < players_; ++rank) {
+        const Rating& r = table[order[rank]];
+        out << std::left << std::setw(5) << rank + 1 << std::setw(width + 2) << names[order[rank]] << std::right
+            << std::setprecision(0) << std::setw(7) << r.elo << std::setw(7) << r.error << std::setw(8) << r.games
+            << std::setprecision(1) << std::setw(7) << 100 * r.score << "%\n";
+    }
+    return out.str();
+}
+
+}  // namespace wallgo
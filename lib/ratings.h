@@ -0,0 +1,53 @@
+#ifndef WALLGO_RATINGS_H
+#define WALLGO_RATINGS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wallgo {
+
+// Elo ratings of several players from the games they played against each other, as BayesElo and Ordo compute them:
+// the maximum likelihood fit of the Bradley-Terry model P(i beats j) = 1 / (1 + 10^((elo_j - elo_i) / 400)). Wall Go
+// has no draws, so the model needs no draw parameter.
+//
+// As in BayesElo, a prior of a few virtual games against an average opponent keeps the ratings of unbeaten or winless
+// players finite and pulls players with few games towards the average. Ratings are shifted to average 0, as in Ordo.
+//
+// The fit uses the minorization-maximization iteration of Hunter (2004). It starts from the previous ratings, so after
+// adding a few games, a few iterations bring the table up to date.
+class RatingTable {
+   public:
+    struct Rating {
+        double elo;
+        double error;  // Half width of the 95% confidence interval, from the curvature of the likelihood
+        uint64_t games;
+        double score;  // Fraction of games won
+    };
+
+   private:
+    int players_;
+    double prior_;
+    std::vector<uint64_t> wins_;   // wins_[i * players_ + j]: games i won against j
+    std::vector<double> gamma_;    // 10^(elo / 400) of each player, before shifting to average 0
+
+   public:
+    // prior is the number of virtual wins and of virtual losses of every player against an opponent rated 0.
+    explicit RatingTable(int players, double prior = 1);
+
+    void add_game(int winner, int loser);
+
+    // Runs iterations of the fit, stopping early once no rating moves by more than tolerance Elo.
+    void update(int iterations = 100, double tolerance = 1e-3);
+
+    int players() const { return players_; }
+    uint64_t wins(int player, int opponent) const { return wins_[player * players_ + opponent]; }
+    std::vector<Rating> ratings() const;
+
+    // The ratings as a table sorted by Elo, one player per line, with names indexed like the players.
+    std::string format(const std::vector<std::string>& names) const;
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_RATINGS_H
@@ -0,0 +1,169 @@
+#include "regions.h"
+
+#include <algorithm>
+
+namespace wallgo {
+
+namespace {
+
+// Offset of the neighbor in each Direction, in cells indexed r * 7 + c.
+constexpr int STEP[4] = {-7, 7, -1, 1};
+
+int index(Position pos) { return pos.r * 7 + pos.c; }
+
+}  // namespace
+
+RegionMap::RegionMap(const Board& board) {
+    for (int r = 0; r < 7; ++r) {
+        for (int c = 0; c < 7; ++c) {
+            const Cell& cell = board.get({r, c});
+            uint8_t open = 0;
+            for (int d = 0; d < 4; ++d) {
+                if (cell.wall(static_cast<Direction>(d)) == WallType::None) open |= 1 << d;
+            }
+            open_[r * 7 + c] = open;
+            piece_[r * 7 + c] = cell.piece() ? static_cast<int8_t>(cell.piece()->owner) : 0;
+        }
+    }
+
+    region_.fill(-1);
+    std::array<int, 49> stack;
+    for (int start = 0; start < 49; ++start) {
+        if (region_[start] != -1) continue;
+        int id = static_cast<int>(regions_.size());
+        Region region = {0, {0, 0, 0}};
+        int top = 0;
+        stack[top++] = start;
+        region_[start] = id;
+        while (top > 0) {
+            int cell = stack[--top];
+            ++region.size;
+            ++region.pieces[piece_[cell]];
+            for (int d = 0; d < 4; ++d) {
+                int next = cell + STEP[d];
+                if ((open_[cell] >> d & 1) && region_[next] == -1) {
+                    region_[next] = id;
+                    stack[top++] = next;
+                }
+            }
+        }
+        regions_.push_back(region);
+    }
+}
+
+void RegionMap::add_wall(int cell, Direction d) {
+    int other = cell + STEP[static_cast<int>(d)];
+    open_[cell] &= ~(1 << static_cast<int>(d));
+    open_[other] &= ~(1 << (static_cast<int>(d) ^ 1));  // Up/Down and Left/Right differ in the lowest bit
+
+    // Alternate between the two searches until they meet, or one side has no cells left to visit.
+    std::array<int8_t, 49> side = {};
+    std::array<int, 49> queue[2];
+    int head[2] = {0, 0}, tail[2] = {1, 1};
+    queue[0][0] = cell;
+    queue[1][0] = other;
+    side[cell] = 1;
+    side[other] = 2;
+    while (true) {
+        for (int s = 0; s < 2; ++s) {
+            if (head[s] == tail[s]) {
+                // The cells found from this side are cut off from the rest of the region.
+                int old_id = region_[queue[s][0]], id = static_cast<int>(regions_.size());
+                Region region = {0, {0, 0, 0}};
+                for (int i = 0; i < tail[s]; ++i) {
+                    int x = queue[s][i];
+                    region_[x] = id;
+                    ++region.size;
+                    ++region.pieces[piece_[x]];
+                }
+                Region& rest = regions_[old_id];
+                rest.size -= region.size;
+                for (int color = 0; color < 3; ++color) {
+                    rest.pieces[color] -= region.pieces[color];
+                }
+                regions_.push_back(region);
+                return;
+            }
+            int x = queue[s][head[s]++];
+            for (int dir = 0; dir < 4; ++dir) {
+                if (!(open_[x] >> dir & 1)) continue;
+                int y = x + STEP[dir];
+                if (side[y] == s + 1) continue;
+                if (side[y] != 0) return;  // Still connected
+                side[y] = s + 1;
+                queue[s][tail[s]++] = y;
+            }
+        }
+    }
+}
+
+void RegionMap::apply(const Board& board, const Move& move) {
+    Position from = board.get_piece(move.player(), move.piece_id()).pos;
+    Position to = from.move(move.direction1()).move(move.direction2());
+    // The piece stays in its region, so only the cells change.
+    piece_[index(from)] = 0;
+    piece_[index(to)] = static_cast<int8_t>(move.player());
+    add_wall(index(to), move.wall_placement_direction());
+}
+
+CellStatus RegionMap::classify(const Region& region) {
+    bool red = region.pieces[static_cast<int>(PlayerColor::Red)] > 0;
+    bool blue = region.pieces[static_cast<int>(PlayerColor::Blue)] > 0;
+    if (red && blue) return CellStatus::Contested;
+    if (red) return CellStatus::SettledRed;
+    if (blue) return CellStatus::SettledBlue;
+    return CellStatus::Dead;
+}
+
+CellStatus RegionMap::status(Position pos) const { return classify(regions_[region(pos)]); }
+
+int RegionMap::count(CellStatus status) const {
+    int total = 0;
+    for (const Region& region : regions_) {
+        if (classify(region) == status) total += region.size;
+    }
+    return total;
+}
+
+Board::GetTerritoryResult RegionMap::territory() const {
+    Board::GetTerritoryResult result = {0, 0, 0, 0};
+    for (const Region& region : regions_) {
+        CellStatus status = classify(region);
+        if (status == CellStatus::SettledRed) {
+            result.red_total += region.size;
+            result.red_max = std::max(result.red_max, region.size);
+        } else if (status == CellStatus::SettledBlue) {
+            result.blue_total += region.size;
+            result.blue_max = std::max(result.blue_max, region.size);
+        }
+    }
+    return result;
+}
+
+int RegionMap::min_margin() const {
+    return count(CellStatus::SettledRed) - count(CellStatus::SettledBlue) - count(CellStatus::Contested);
+}
+
+int RegionMap::max_margin() const {
+    return count(CellStatus::SettledRed) - count(CellStatus::SettledBlue) + count(CellStatus::Contested);
+}
+
+std::optional<PlayerColor> RegionMap::decided_winner() const {
+    if (min_margin() > 0) return PlayerColor::Red;
+    if (max_margin() < 0) return PlayerColor::Blue;
+    return std::nullopt;
+}
+
+std::vector<Move> unlocked_moves(const Board& board, const RegionMap& regions, PlayerColor player) {
+    bool locked[4] = {};
+    for (const Piece& piece : board.get_pieces(player)) {
+        if (piece.id >= 0 && piece.id < 4) locked[piece.id] = regions.locked(piece.pos);
+    }
+    std::vector<Move> moves;
+    for (PackedMove move : board.get_packed_moves(player)) {
+        if (!locked[move.piece_id()]) moves.push_back(move.unpack());
+    }
+    return moves;
+}
+
+}  // namespace wallgo
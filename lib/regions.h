@@ -0,0 +1,87 @@
+#ifndef WALLGO_REGIONS_H
+#define WALLGO_REGIONS_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+// What can still happen to a cell. Regions are the sets of cells connected without crossing a wall, as in
+// Board::get_territory. Walls are never removed and pieces never cross walls, so a region only ever splits, and a
+// region that holds pieces of one color, or none, stays that way until the end of the game.
+enum class CellStatus : uint8_t {
+    Contested,    // In a region with pieces of both colors
+    SettledRed,   // In a region with only red pieces; counts for Red at the end
+    SettledBlue,  // In a region with only blue pieces; counts for Blue at the end
+    Dead,         // In a region without pieces; counts for nobody
+};
+
+// Regions of a board and the status of every cell, kept up to date as moves are applied.
+//
+// A wall can only split the region it is placed in. apply searches from both cells the wall separates, one cell at a
+// time from either side, until the searches meet or one of them runs out; the side that ran out is the new region.
+// A wall that does not split anything therefore costs a search of about the shorter way around it.
+class RegionMap {
+   private:
+    struct Region {
+        int size;
+        int pieces[3];  // Indexed by PlayerColor
+    };
+
+    std::array<uint8_t, 49> open_;  // Bit d is set if the cell has no wall in Direction d
+    std::array<int8_t, 49> piece_;  // PlayerColor of the piece on each cell, 0 if none
+    std::array<int8_t, 49> region_;
+    std::vector<Region> regions_;
+
+    static CellStatus classify(const Region& region);
+    void add_wall(int cell, Direction d);
+
+   public:
+    explicit RegionMap(const Board& board);
+
+    // Updates the map of board, the position before move, to the position after it.
+    void apply(const Board& board, const Move& move);
+
+    CellStatus status(Position pos) const;
+
+    // Id of the region of a cell. Ids are below region_count().
+    int region(Position pos) const { return region_[pos.r * 7 + pos.c]; }
+    int region_count() const { return static_cast<int>(regions_.size()); }
+    int region_size(int id) const { return regions_[id].size; }
+
+    // Number of cells the piece on pos can ever reach: the size of its region.
+    int piece_area(Position pos) const { return region_size(region(pos)); }
+
+    // Whether the piece on pos is sealed off from all opponent pieces. Its moves no longer affect the contested
+    // regions, but they still matter: a wall can cut a dead pocket out of its own settled region, lowering its color's
+    // total and largest area, and a move of a locked piece can spend a tempo when every move of an unlocked piece
+    // concedes cells.
+    bool locked(Position pos) const { return status(pos) != CellStatus::Contested; }
+
+    // Number of cells with each status.
+    int count(CellStatus status) const;
+
+    // Territory as Board::get_territory computes it: settled regions count for their color.
+    Board::GetTerritoryResult territory() const;
+
+    // Bounds on Red's final total minus Blue's: every contested cell may still go to either color or to nobody.
+    int min_margin() const;
+    int max_margin() const;
+
+    // The winner, if the settled cells alone decide the totals whatever happens to the contested ones.
+    std::optional<PlayerColor> decided_winner() const;
+};
+
+// Legal moves of player's pieces that are not locked. If every piece of player is locked, the game is over.
+//
+// This is a heuristic pruning, not a safe one: it can drop the only move that does not lose, a tempo move of a locked
+// piece when every move of an unlocked piece gives up territory. Search that must be exact should not use it.
+std::vector<Move> unlocked_moves(const Board& board, const RegionMap& regions, PlayerColor player);
+
+}  // namespace wallgo
+
+#endif  // WALLGO_REGIONS_H
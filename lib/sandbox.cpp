@@ -0,0 +1,327 @@
+#include "sandbox.h"
+
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+#include "geometry.h"
+#include "instrumentation.h"
+
+namespace wallgo {
+
+namespace {
+
+// Most moves a player can have: 4 pieces, each with every path and wall direction.
+constexpr int MAX_MOVES = 4 * MovePaths::MAX * 4;
+constexpr int MAX_GAME_STRING = 4096;
+
+// How often the watchdog looks at a child that has not answered yet.
+constexpr std::chrono::milliseconds WATCHDOG_PERIOD(2);
+
+enum class Request : uint8_t { Init, Limits, Place, Move, Placed, Moved, GameOver, Quit };
+
+double cpu_seconds(clockid_t clock) {
+    timespec ts;
+    if (clock_gettime(clock, &ts) != 0) return 0;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+}  // namespace
+
+// The page shared with the child. The parent fills in a request and posts request; the child fills in the answer
+// and posts answer.
+struct SandboxedPlayer::Channel {
+    sem_t request, answer;
+    Request kind;
+
+    // Request
+    int color, seed;
+    SearchLimits limits;
+    PieceId piece_id;
+    Piece piece;
+    int winner, reason;
+    int count;
+    uint8_t cells[Board::SIZE * Board::SIZE];  // r * 7 + c of each valid position
+    PackedMove moves[MAX_MOVES];
+    char game[MAX_GAME_STRING];  // Game string for Init and GameOver, null-terminated
+
+    // Answer
+    bool ok;
+    uint8_t cell;
+    PackedMove move;
+    SearchStats stats;
+    char error[256];
+};
+
+SandboxedPlayer::SandboxedPlayer(std::function<std::unique_ptr<Player>()> make_player, const SandboxOptions& options)
+    : options_(options) {
+    void* page = mmap(nullptr, sizeof(Channel), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        throw std::runtime_error(std::string("Cannot map the sandbox channel: ") + std::strerror(errno));
+    }
+    channel_ = new (page) Channel();
+    sem_init(&channel_->request, 1, 0);
+    sem_init(&channel_->answer, 1, 0);
+
+    // Flush first so that the child does not write out the parent's buffered output again.
+    std::cout.flush();
+    std::cerr.flush();
+    pid_ = fork();
+    if (pid_ < 0) {
+        munmap(channel_, sizeof(Channel));
+        throw std::runtime_error(std::string("Cannot fork the sandbox: ") + std::strerror(errno));
+    }
+    if (pid_ == 0) {
+        rlimit core{0, 0};
+        setrlimit(RLIMIT_CORE, &core);
+        if (options_.memory_bytes) {
+            rlimit memory{options_.memory_bytes, options_.memory_bytes};
+            setrlimit(RLIMIT_AS, &memory);
+        }
+        serve(*channel_, make_player);
+    }
+    if (clock_getcpuclockid(pid_, &cpu_clock_) != 0) {
+        kill(pid_, SIGKILL);
+        waitpid(pid_, nullptr, 0);
+        munmap(channel_, sizeof(Channel));
+        throw std::runtime_error("Cannot read the CPU clock of the sandbox");
+    }
+}
+
+SandboxedPlayer::~SandboxedPlayer() {
+    // A child that was killed or died has been reaped already.
+    channel_->kind = Request::Quit;
+    if (call(0)) waitpid(pid_, nullptr, 0);
+    sem_destroy(&channel_->request);
+    sem_destroy(&channel_->answer);
+    munmap(channel_, sizeof(Channel));
+}
+
+void SandboxedPlayer::fail(State state, const std::string& message) {
+    state_ = state;
+    error_ = message;
+    std::cerr << "Sandbox " << pid_ << ": " << message << std::endl;
+}
+
+bool SandboxedPlayer::call(double cpu_allowance) {
+    charged_.reset();
+    if (state_ != State::Running) return false;
+    bool quit = channel_->kind == Request::Quit;
+    double cpu_start = cpu_seconds(cpu_clock_);
+    auto wall_start = std::chrono::steady_clock::now();
+    double wall_allowance = cpu_allowance > 0 ? cpu_allowance * options_.wall_factor : options_.hang_seconds;
+    sem_post(&channel_->request);
+    while (true) {
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += std::chrono::nanoseconds(WATCHDOG_PERIOD).count();
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        if (sem_timedwait(&channel_->answer, &deadline) == 0) {
+            if (!channel_->ok && !quit) {
+                kill(pid_, SIGKILL);
+                waitpid(pid_, nullptr, 0);
+                fail(State::Crashed, std::string("player threw: ") + channel_->error);
+                return false;
+            }
+            charged_ = cpu_seconds(cpu_clock_) - cpu_start;
+            return true;
+        }
+        int status;
+        if (waitpid(pid_, &status, WNOHANG) == pid_) {
+            fail(State::Crashed, WIFSIGNALED(status) ? "died from signal " + std::to_string(WTERMSIG(status))
+                                                     : "exited with status " + std::to_string(WEXITSTATUS(status)));
+            return false;
+        }
+        double cpu_used = cpu_seconds(cpu_clock_) - cpu_start;
+        std::chrono::duration<double> wall_used = std::chrono::steady_clock::now() - wall_start;
+        if ((cpu_allowance > 0 && cpu_used > cpu_allowance) || wall_used.count() > wall_allowance) {
+            kill(pid_, SIGKILL);
+            waitpid(pid_, nullptr, 0);
+            fail(State::Killed, "killed after " + std::to_string(cpu_used) + "s of CPU time and " +
+                                    std::to_string(wall_used.count()) + "s of wall time");
+            charged_ = std::max({cpu_used, wall_used.count(), limits_.remaining + options_.slack});
+            return false;
+        }
+    }
+}
+
+Forfeit SandboxedPlayer::forfeit() const {
+    return Forfeit(state_ == State::Killed ? OPPONENT_TLE : OPPONENT_ILLEGAL_MOVE, "sandbox " + error_);
+}
+
+void SandboxedPlayer::init(PlayerColor player, std::shared_ptr<const Game> game, int seed) {
+    std::string encoded = game->encode();
+    if (encoded.size() >= MAX_GAME_STRING) {
+        fail(State::Crashed, "game string too long to marshal");
+        return;
+    }
+    channel_->kind = Request::Init;
+    channel_->color = static_cast<int>(player);
+    channel_->seed = seed;
+    std::memcpy(channel_->game, encoded.c_str(), encoded.size() + 1);
+    call(0);
+}
+
+void SandboxedPlayer::set_limits(const SearchLimits& limits) {
+    limits_ = limits;
+    channel_->kind = Request::Limits;
+    channel_->limits = limits;
+    call(0);
+}
+
+Position SandboxedPlayer::place(PieceId pieceId, const std::vector<Position>& valid_positions) {
+    has_stats_ = false;
+    channel_->kind = Request::Place;
+    channel_->piece_id = pieceId;
+    channel_->count = static_cast<int>(valid_positions.size());
+    for (size_t i = 0; i < valid_positions.size(); ++i) {
+        channel_->cells[i] = static_cast<uint8_t>(valid_positions[i].r * Board::SIZE + valid_positions[i].c);
+    }
+    double allowance = limits_.nodes || limits_.depth ? 0 : limits_.remaining + options_.slack;
+    if (call(allowance)) {
+        stats_ = channel_->stats;
+        has_stats_ = true;
+        if (channel_->cell == UINT8_MAX) return Position{-1, -1};
+        return Position{channel_->cell / Board::SIZE, channel_->cell % Board::SIZE};
+    }
+    throw forfeit();
+}
+
+Move SandboxedPlayer::move(const std::vector<Move>& valid_moves) {
+    has_stats_ = false;
+    channel_->kind = Request::Move;
+    channel_->count = static_cast<int>(std::min<size_t>(valid_moves.size(), MAX_MOVES));
+    for (int i = 0; i < channel_->count; ++i) {
+        channel_->moves[i] = PackedMove(valid_moves[i]);
+    }
+    double allowance = limits_.nodes || limits_.depth ? 0 : limits_.remaining + options_.slack;
+    if (call(allowance)) {
+        stats_ = channel_->stats;
+        has_stats_ = true;
+        for (const Move& move : valid_moves) {
+            if (PackedMove(move) == channel_->move) return move;
+        }
+        throw Forfeit(OPPONENT_ILLEGAL_MOVE, "illegal move " + channel_->move.encode());
+    }
+    throw forfeit();
+}
+
+void SandboxedPlayer::on_placement(const Piece& piece) {
+    channel_->kind = Request::Placed;
+    channel_->piece = piece;
+    call(0);
+}
+
+void SandboxedPlayer::on_move(const Move& move) {
+    channel_->kind = Request::Moved;
+    channel_->move = PackedMove(move);
+    call(0);
+}
+
+void SandboxedPlayer::on_game_over(const GameOutcome& outcome) {
+    if (outcome.encoded_game.size() >= MAX_GAME_STRING) return;
+    channel_->kind = Request::GameOver;
+    channel_->winner = static_cast<int>(outcome.winner);
+    channel_->reason = outcome.reason;
+    std::memcpy(channel_->game, outcome.encoded_game.c_str(), outcome.encoded_game.size() + 1);
+    call(0);
+}
+
+void SandboxedPlayer::serve(Channel& channel, const std::function<std::unique_ptr<Player>()>& make_player) {
+    std::unique_ptr<Player> player;
+    std::shared_ptr<Game> game;
+    while (true) {
+        while (sem_wait(&channel.request) != 0) {
+        }
+        channel.ok = true;
+        try {
+            switch (channel.kind) {
+                case Request::Init:
+                    game = std::make_shared<Game>(Game::decode(channel.game));
+                    player = make_player();
+                    player->init(static_cast<PlayerColor>(channel.color), game, channel.seed);
+                    break;
+                case Request::Limits:
+                    player->set_limits(channel.limits);
+                    break;
+                case Request::Place: {
+                    std::vector<Position> valid_positions(channel.count);
+                    for (int i = 0; i < channel.count; ++i) {
+                        valid_positions[i] = {channel.cells[i] / Board::SIZE, channel.cells[i] % Board::SIZE};
+                    }
+                    SearchStats stats;
+                    Position pos;
+                    {
+                        WALLGO_RECORD_SEARCH(stats);
+                        pos = player->place(channel.piece_id, valid_positions);
+                    }
+                    if (const SearchStats* reported = player->search_stats()) stats += *reported;
+                    channel.stats = stats;
+                    bool on_board = pos.r >= 0 && pos.r < Board::SIZE && pos.c >= 0 && pos.c < Board::SIZE;
+                    channel.cell = on_board ? static_cast<uint8_t>(pos.r * Board::SIZE + pos.c) : UINT8_MAX;
+                    break;
+                }
+                case Request::Move: {
+                    std::vector<Move> valid_moves;
+                    valid_moves.reserve(channel.count);
+                    for (int i = 0; i < channel.count; ++i) {
+                        valid_moves.push_back(channel.moves[i].unpack());
+                    }
+                    SearchStats stats;
+                    std::optional<Move> chosen;
+                    {
+                        WALLGO_RECORD_SEARCH(stats);
+                        chosen = player->move(valid_moves);
+                    }
+                    if (const SearchStats* reported = player->search_stats()) stats += *reported;
+                    channel.stats = stats;
+                    channel.move = PackedMove(*chosen);
+                    break;
+                }
+                case Request::Placed:
+                    game->place_piece(channel.piece.pos, channel.piece.owner, channel.piece.id);
+                    player->on_placement(channel.piece);
+                    break;
+                case Request::Moved: {
+                    Move move = channel.move.unpack();
+                    game->apply_move(move);
+                    player->on_move(move);
+                    break;
+                }
+                case Request::GameOver: {
+                    GameOutcome outcome{static_cast<PlayerColor>(channel.winner), static_cast<Reason>(channel.reason),
+                                        channel.game, "", {}};
+                    player->on_game_over(outcome);
+                    player.reset();
+                    game.reset();
+                    break;
+                }
+                case Request::Quit:
+                    std::cout.flush();
+                    std::cerr.flush();
+                    sem_post(&channel.answer);
+                    _exit(0);
+            }
+        } catch (const std::exception& e) {
+            channel.ok = false;
+            std::strncpy(channel.error, e.what(), sizeof(channel.error) - 1);
+        }
+        sem_post(&channel.answer);
+    }
+}
+
+}  // namespace wallgo
@@ -0,0 +1,89 @@
+#ifndef WALLGO_SANDBOX_H
+#define WALLGO_SANDBOX_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "types.h"
+
+namespace wallgo {
+
+// Limits of a sandboxed player process.
+struct SandboxOptions {
+    uint64_t memory_bytes = 2ull << 30;  // Address space limit (RLIMIT_AS) of the process, 0 for none
+    double slack = 0.25;                 // CPU seconds past the remaining budget before a decision is killed
+    double wall_factor = 4;              // Multiple of its CPU allowance a decision may take in wall time
+    double hang_seconds = 10;            // Wall time after which other calls and node-budget decisions are killed
+};
+
+// A player that runs in a forked child process, so that it cannot hang the controller or take it down.
+//
+// The child is forked when the SandboxedPlayer is constructed and creates the player with make_player. Every call is
+// marshalled through a shared memory page: the parent writes the request, posts a semaphore and waits for the answer.
+// Every call is charged the CPU time of the child process, the sum over all its threads, instead of wall time (see
+// Player::charged_seconds), so that IPC round trips and load from other processes do not count against a player.
+//
+// A watchdog kills the child when a decision uses more CPU time than the player has left plus the slack, or blocks
+// for too long in wall time. The decision is then charged the time it took and throws Forfeit with OPPONENT_TLE. If
+// the child dies on its own, e.g. from a crash or the memory limit, or answers a move that is not valid, the decision
+// throws Forfeit with OPPONENT_ILLEGAL_MOVE.
+class SandboxedPlayer : public Player {
+   private:
+    struct Channel;
+
+    enum class State { Running, Killed, Crashed };
+
+    SandboxOptions options_;
+    Channel* channel_ = nullptr;
+    pid_t pid_ = -1;
+    clockid_t cpu_clock_;
+    State state_ = State::Running;
+    std::string error_;
+    SearchLimits limits_{};
+    SearchStats stats_;
+    bool has_stats_ = false;
+    std::optional<double> charged_;
+
+    // Runs the request in the channel and waits for the answer, killing the child if it takes longer than
+    // cpu_allowance CPU seconds (none if 0) or the wall time the options allow. Returns true if it answered.
+    bool call(double cpu_allowance);
+    void fail(State state, const std::string& message);
+
+    // The exception a decision throws once the child has been killed or died.
+    Forfeit forfeit() const;
+
+    // Serves requests in the child until Quit, then exits without running the parent's exit handlers.
+    [[noreturn]] static void serve(Channel& channel, const std::function<std::unique_ptr<Player>()>& make_player);
+
+   public:
+    // Throws std::runtime_error if the child cannot be started.
+    explicit SandboxedPlayer(std::function<std::unique_ptr<Player>()> make_player,
+                             const SandboxOptions& options = SandboxOptions());
+    ~SandboxedPlayer();
+
+    SandboxedPlayer(const SandboxedPlayer&) = delete;
+    SandboxedPlayer& operator=(const SandboxedPlayer&) = delete;
+
+    void init(PlayerColor player, std::shared_ptr<const Game> game, int seed) override;
+    Position place(PieceId pieceId, const std::vector<Position>& valid_positions) override;
+    Move move(const std::vector<Move>& valid_moves) override;
+    void set_limits(const SearchLimits& limits) override;
+    void on_placement(const Piece& piece) override;
+    void on_move(const Move& move) override;
+    void on_game_over(const GameOutcome& outcome) override;
+    const SearchStats* search_stats() const override { return has_stats_ ? &stats_ : nullptr; }
+    std::optional<double> charged_seconds() const override { return charged_; }
+
+    // Why the child was killed or died, empty while it runs.
+    const std::string& error() const { return error_; }
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_SANDBOX_H
@@ -0,0 +1,161 @@
+#include "solver.h"
+
+#include <algorithm>
+
+#include "instrumentation.h"
+#include "zobrist.h"
+
+namespace wallgo {
+
+namespace {
+
+constexpr size_t BUCKET = 4;  // Entries a key may occupy, in one cache-friendly run
+
+uint32_t add(uint32_t a, uint32_t b) {
+    return static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(a) + b, ProofSolver::INF));
+}
+
+}  // namespace
+
+ProofSolver::ProofSolver(size_t megabytes) {
+    size_t entries = megabytes * (1 << 20) / sizeof(Entry), size = BUCKET;
+    while (size * 2 <= entries) size *= 2;
+    table_.resize(size);
+}
+
+void ProofSolver::clear() { std::fill(table_.begin(), table_.end(), Entry{}); }
+
+const ProofSolver::Entry* ProofSolver::probe(uint64_t key) const {
+    WALLGO_COUNT(tt_probes, 1);
+    const Entry* bucket = &table_[key & (table_.size() - BUCKET)];
+    for (size_t i = 0; i < BUCKET; ++i) {
+        if (bucket[i].key == key) {
+            WALLGO_COUNT(tt_hits, 1);
+            return &bucket[i];
+        }
+    }
+    return nullptr;
+}
+
+void ProofSolver::store(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work) {
+    Entry* bucket = &table_[key & (table_.size() - BUCKET)];
+    Entry* slot = nullptr;
+    for (size_t i = 0; i < BUCKET && !slot; ++i) {
+        if (bucket[i].key == key) slot = &bucket[i];
+    }
+    if (slot) {
+        work = std::max(work, slot->work);
+    } else {
+        // Empty slots have no work, so they go first.
+        slot = std::min_element(bucket, bucket + BUCKET,
+                                [](const Entry& a, const Entry& b) { return a.work < b.work; });
+    }
+    *slot = {key, pn, dn, work};
+}
+
+std::optional<PlayerColor> ProofSolver::decided(const RegionMap& regions, PlayerColor last_mover) {
+    if (regions.count(CellStatus::Contested) == 0) {
+        return decide_winner(regions.territory(), last_mover).first;
+    }
+    return regions.decided_winner();
+}
+
+// The children of a position, with their proof and disproof numbers from the table. Children that are not in the
+// table are checked for a decided result, which is stored; the others start at 1 and 1.
+std::vector<ProofSolver::Child> ProofSolver::expand(const Board& board, const RegionMap& regions, PlayerColor to_act,
+                                                    uint64_t key) {
+    std::vector<PackedMove> moves = board.get_packed_moves(to_act);
+    std::vector<Child> children;
+    children.reserve(moves.size());
+    for (PackedMove packed : moves) {
+        Move move = packed.unpack();
+        Position from = board.get_piece(to_act, move.piece_id()).pos;
+        Position to = from.move(move.direction1()).move(move.direction2());
+        uint64_t child_key = key ^ zobrist::piece_key(to_act, from) ^ zobrist::piece_key(to_act, to) ^
+                             zobrist::wall_key(to, move.wall_placement_direction()) ^ zobrist::side_key();
+        Child child{packed, child_key, 1, 1};
+        if (const Entry* entry = probe(child_key)) {
+            child.pn = entry->pn;
+            child.dn = entry->dn;
+        } else {
+            ++nodes_;
+            RegionMap next = regions;
+            next.apply(board, move);
+            if (std::optional<PlayerColor> winner = decided(next, to_act)) {
+                bool child_wins = *winner != to_act;
+                child.pn = child_wins ? 0 : INF;
+                child.dn = child_wins ? INF : 0;
+                store(child_key, child.pn, child.dn, 0);
+            }
+        }
+        children.push_back(child);
+    }
+    return children;
+}
+
+// Nagai's MID: searches the position until its proof number reaches thpn or its disproof number reaches thdn, or the
+// node budget runs out, and stores the numbers it ends with. Numbers are from the point of view of the player to act,
+// so a position's proof number is the least disproof number of its children and its disproof number is the sum of
+// their proof numbers.
+void ProofSolver::search(const Board& board, const RegionMap& regions, PlayerColor to_act, uint64_t key,
+                         uint32_t thpn, uint32_t thdn) {
+    uint64_t start = nodes_;
+    std::vector<Child> children = expand(board, regions, to_act, key);
+    while (true) {
+        Child* best = nullptr;
+        uint32_t pn = INF, dn = 0, second = INF;
+        for (Child& child : children) {
+            if (const Entry* entry = probe(child.key)) {
+                child.pn = entry->pn;
+                child.dn = entry->dn;
+            }
+            dn = add(dn, child.pn);
+            if (child.dn < pn) {
+                second = pn;
+                pn = child.dn;
+                best = &child;
+            } else if (child.dn < second) {
+                second = child.dn;
+            }
+        }
+        if (!best || pn >= thpn || dn >= thdn || nodes_ >= max_nodes_) {
+            store(key, pn, dn, static_cast<uint32_t>(std::min<uint64_t>(nodes_ - start, UINT32_MAX)));
+            return;
+        }
+        Move move = best->move.unpack();
+        RegionMap next = regions;
+        next.apply(board, move);
+        search(board.apply_move(move), next, opponent_of(to_act), best->key, add(thdn - dn, best->pn),
+               std::min(thpn, add(second, 1)));
+    }
+}
+
+SolveResult ProofSolver::solve(const Board& board, PlayerColor to_act, uint64_t max_nodes) {
+    nodes_ = 0;
+    max_nodes_ = max_nodes;
+    RegionMap regions(board);
+    if (regions.count(CellStatus::Contested) == 0) {
+        // The game is over; there is no move to make.
+        PlayerColor winner = decide_winner(regions.territory(), opponent_of(to_act)).first;
+        return {winner == to_act ? Proof::Win : Proof::Loss, std::nullopt, 0};
+    }
+    uint64_t key = zobrist::hash(board, to_act);
+    const Entry* entry = probe(key);
+    if (!entry || (entry->pn != 0 && entry->dn != 0)) {
+        search(board, regions, to_act, key, INF, INF);
+    }
+
+    // The table ignores piece ids, so its entry for this position may come from one with the pieces swapped; pick the
+    // move from this position's own children.
+    std::vector<Child> children = expand(board, regions, to_act, key);
+    auto best = std::min_element(children.begin(), children.end(),
+                                 [](const Child& a, const Child& b) { return a.dn < b.dn; });
+    uint32_t pn = best == children.end() ? INF : best->dn, dn = 0;
+    for (const Child& child : children) dn = add(dn, child.pn);
+    Proof proof = pn == 0 ? Proof::Win : dn == 0 ? Proof::Loss : Proof::Unknown;
+    std::optional<Move> move;
+    if (best != children.end()) move = best->move.unpack();
+    return {proof, move, nodes_};
+}
+
+}  // namespace wallgo
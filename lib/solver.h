@@ -0,0 +1,73 @@
+#ifndef WALLGO_SOLVER_H
+#define WALLGO_SOLVER_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "regions.h"
+#include "types.h"
+
+namespace wallgo {
+
+// Result of a position for the player to act.
+enum class Proof : uint8_t { Unknown, Win, Loss };
+
+struct SolveResult {
+    Proof proof;
+    std::optional<Move> best;  // A winning move if proof is Win; otherwise the move that looked hardest to refute
+    uint64_t nodes;            // Positions visited by this call
+};
+
+// Proves or disproves that the player to act wins, by depth-first proof-number search (df-pn, Nagai 2002) over win
+// and loss outcomes. A position is decided when the game is over, scored with the controller's tie-breaks (see
+// decide_winner), or when the settled cells alone decide the totals (RegionMap::decided_winner). Every move places a
+// wall, so no position repeats and the search graph has no cycles.
+//
+// Proof and disproof numbers live only in the transposition table, whose size is fixed when the solver is created:
+// the search keeps nothing else per position beyond the moves of the positions on its current path. When the table
+// is full, entries that took the least work to compute are replaced first. The table is kept between calls, so
+// solving the positions of a game from the last one backwards, or again with a larger budget, reuses earlier work.
+//
+// A solver is not thread-safe; give each thread its own.
+class ProofSolver {
+   public:
+    static constexpr uint32_t INF = UINT32_MAX / 2;
+
+   private:
+    struct Entry {
+        uint64_t key = 0;  // 0 marks an empty slot
+        uint32_t pn = 1, dn = 1;
+        uint32_t work = 0;  // Positions visited to compute pn and dn, a measure of what replacing them would cost
+    };
+
+    struct Child {
+        PackedMove move;
+        uint64_t key;
+        uint32_t pn, dn;
+    };
+
+    std::vector<Entry> table_;
+    uint64_t nodes_ = 0, max_nodes_ = 0;
+
+    const Entry* probe(uint64_t key) const;
+    void store(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work);
+    std::vector<Child> expand(const Board& board, const RegionMap& regions, PlayerColor to_act, uint64_t key);
+    static std::optional<PlayerColor> decided(const RegionMap& regions, PlayerColor last_mover);
+    void search(const Board& board, const RegionMap& regions, PlayerColor to_act, uint64_t key, uint32_t thpn,
+                uint32_t thdn);
+
+   public:
+    // megabytes is the size of the transposition table.
+    explicit ProofSolver(size_t megabytes = 64);
+
+    // Searches the position on board with to_act to move, visiting at most max_nodes positions.
+    SolveResult solve(const Board& board, PlayerColor to_act, uint64_t max_nodes);
+
+    // Forgets all positions.
+    void clear();
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_SOLVER_H
@@ -0,0 +1,79 @@
+#include "sprt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace wallgo {
+
+namespace {
+
+// Expected score of a strategy that is elo stronger.
+double elo_to_score(double elo) { return 1 / (1 + std::pow(10, -elo / 400)); }
+
+double score_to_elo(double score) {
+    score = std::clamp(score, 1e-6, 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+// Pseudo-count added to every pair outcome by the test. Without it, the variance after a few pairs with the same
+// outcome is close to zero and the LLR jumps past either bound.
+constexpr double PRIOR = 1;
+
+}  // namespace
+
+Sprt::Sprt(double elo0, double elo1, double alpha, double beta)
+    : elo0_(elo0), elo1_(elo1), lower_(std::log(beta / (1 - alpha))), upper_(std::log((1 - beta) / alpha)) {
+    if (!(elo0 < elo1)) throw std::invalid_argument("SPRT needs elo0 < elo1");
+    if (!(alpha > 0 && alpha < 1 && beta > 0 && beta < 1)) {
+        throw std::invalid_argument("SPRT needs 0 < alpha, beta < 1");
+    }
+}
+
+void Sprt::add_pair(int wins) {
+    if (wins < 0 || wins > 2) throw std::invalid_argument("A pair has two games");
+    ++pairs_[wins];
+}
+
+void Sprt::score_stats(double prior, double& mean, double& variance) const {
+    double total = 0, sum = 0;
+    for (int wins = 0; wins <= 2; ++wins) {
+        double count = pairs_[wins] + prior;
+        total += count;
+        sum += count * wins / 2.0;
+    }
+    mean = sum / total;
+    variance = 0;
+    for (int wins = 0; wins <= 2; ++wins) {
+        double deviation = wins / 2.0 - mean;
+        variance += (pairs_[wins] + prior) * deviation * deviation;
+    }
+    variance /= total;
+}
+
+double Sprt::llr() const {
+    if (pairs() == 0) return 0;
+    double mean, variance;
+    score_stats(PRIOR, mean, variance);
+    double s0 = elo_to_score(elo0_), s1 = elo_to_score(elo1_);
+    return pairs() * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+Sprt::Status Sprt::status() const {
+    double ratio = llr();
+    if (ratio >= upper_) return Status::AcceptH1;
+    if (ratio <= lower_) return Status::AcceptH0;
+    return Status::Continue;
+}
+
+Sprt::Estimate Sprt::elo() const {
+    if (pairs() == 0) return Estimate{0, std::numeric_limits<double>::infinity()};
+    double mean, variance;
+    score_stats(0, mean, variance);
+    double margin = 1.96 * std::sqrt(variance / pairs());
+    double elo = score_to_elo(mean);
+    return Estimate{elo, (score_to_elo(mean + margin) - score_to_elo(mean - margin)) / 2};
+}
+
+}  // namespace wallgo
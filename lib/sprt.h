@@ -0,0 +1,56 @@
+#ifndef WALLGO_SPRT_H
+#define WALLGO_SPRT_H
+
+#include <array>
+#include <cstdint>
+
+namespace wallgo {
+
+// Sequential probability ratio test of one strategy against another on game pairs, where both games of a pair use
+// the same seed with colors swapped. Testing pairs rather than games cancels most of the color and seed bias.
+//
+// This is the generalized SPRT on logistic Elo used by chess engine testing frameworks: the log-likelihood ratio of
+// elo1 against elo0 is estimated with a normal approximation of the pair score distribution. Wall Go has no draws,
+// so each pair scores 0, 1 or 2 wins and the pentanomial model reduces to three outcomes.
+class Sprt {
+   public:
+    enum class Status { Continue, AcceptH0, AcceptH1 };
+
+    struct Estimate {
+        double elo;
+        double error;  // Half width of the 95% confidence interval
+    };
+
+   private:
+    double elo0_, elo1_;
+    double lower_, upper_;
+    std::array<uint64_t, 3> pairs_{};  // Indexed by the number of games of the pair that the tested strategy won
+
+    // Mean and variance of the score per game, averaged over the two games of a pair, with prior added to the count
+    // of every pair outcome.
+    void score_stats(double prior, double& mean, double& variance) const;
+
+   public:
+    // H0: the tested strategy is elo0 stronger, H1: it is elo1 stronger. alpha and beta are the probabilities of
+    // accepting H1 when H0 holds and of accepting H0 when H1 holds.
+    Sprt(double elo0, double elo1, double alpha = 0.05, double beta = 0.05);
+
+    // Adds a pair in which the tested strategy won wins (0, 1 or 2) of the two games.
+    void add_pair(int wins);
+
+    uint64_t pairs() const { return pairs_[0] + pairs_[1] + pairs_[2]; }
+    uint64_t wins() const { return pairs_[1] + 2 * pairs_[2]; }
+    const std::array<uint64_t, 3>& pair_counts() const { return pairs_; }
+
+    double llr() const;
+    double lower_bound() const { return lower_; }
+    double upper_bound() const { return upper_; }
+    Status status() const;
+
+    // Elo difference implied by the score so far.
+    Estimate elo() const;
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_SPRT_H
@@ -0,0 +1,127 @@
+#include "tournament.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace wallgo {
+
+std::vector<WorkUnit> make_schedule(int participants, bool gauntlet, int rounds, int seed) {
+    std::vector<WorkUnit> units;
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < (gauntlet ? 1 : participants); ++i) {
+            for (int j = i + 1; j < participants; ++j) {
+                int id = static_cast<int>(units.size());
+                units.push_back({id, i, j, static_cast<int>((static_cast<int64_t>(seed) + id) % (int)(1e9 + 7))});
+            }
+        }
+    }
+    return units;
+}
+
+std::string format_result(const UnitResult& result) {
+    std::ostringstream line;
+    line << result.unit.id << ' ' << result.unit.first << ' ' << result.unit.second << ' ' << result.unit.seed;
+    for (const GameResult& game : result.games) {
+        line << ' ' << static_cast<int>(game.winner) << ' ' << static_cast<int>(game.reason) << ' ' << game.game;
+    }
+    return line.str();
+}
+
+std::optional<UnitResult> parse_result(const std::string& line) {
+    std::istringstream fields(line);
+    UnitResult result;
+    if (!(fields >> result.unit.id >> result.unit.first >> result.unit.second >> result.unit.seed)) {
+        return std::nullopt;
+    }
+    for (GameResult& game : result.games) {
+        int winner, reason;
+        if (!(fields >> winner >> reason >> game.game) || (winner != 1 && winner != 2) || reason < BY_TOTAL_AREA ||
+            reason > OPPONENT_ILLEGAL_MOVE) {
+            return std::nullopt;
+        }
+        game.winner = static_cast<PlayerColor>(winner);
+        game.reason = static_cast<Reason>(reason);
+    }
+    std::string rest;
+    if (fields >> rest) return std::nullopt;
+    return result;
+}
+
+// ResultsFile implementation
+
+ResultsFile::ResultsFile(const std::string& path, const std::string& header, std::vector<UnitResult>& recorded) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    std::string content;
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = read(fd_, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, n);
+    }
+    if (n < 0) {
+        close(fd_);
+        throw std::runtime_error("Cannot read " + path + ": " + std::strerror(errno));
+    }
+
+    // Check the file before changing it: only a new file, or one of this tournament, is written to.
+    size_t header_end = content.find('\n');
+    if (header_end == std::string::npos) {
+        // Empty, or a header cut short by a crash while the file was created.
+        if (header.compare(0, content.size(), content) != 0) {
+            close(fd_);
+            throw std::runtime_error(path + " is not a results file");
+        }
+        content = header + '\n';
+        if (ftruncate(fd_, 0) != 0 || pwrite(fd_, content.data(), content.size(), 0) != (ssize_t)content.size() ||
+            fsync(fd_) != 0) {
+            close(fd_);
+            throw std::runtime_error("Cannot write " + path);
+        }
+        header_end = header.size();
+    } else if (content.compare(0, header_end, header) != 0) {
+        close(fd_);
+        throw std::runtime_error(path + " belongs to another tournament: " + content.substr(0, header_end));
+    }
+
+    // Keep only complete lines; the last one may have been cut short by a crash.
+    size_t complete = content.rfind('\n') + 1;
+    std::istringstream lines(content.substr(header_end + 1, complete - header_end - 1));
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::optional<UnitResult> result = parse_result(line);
+        if (!result) {
+            close(fd_);
+            throw std::runtime_error("Malformed line in " + path + ": " + line);
+        }
+        recorded.push_back(*result);
+    }
+    if (complete < content.size() && ftruncate(fd_, complete) != 0) {
+        close(fd_);
+        throw std::runtime_error("Cannot truncate " + path);
+    }
+    lseek(fd_, complete, SEEK_SET);
+}
+
+ResultsFile::~ResultsFile() { close(fd_); }
+
+void ResultsFile::append(const UnitResult& result) {
+    std::string line = format_result(result) + '\n';
+    for (size_t written = 0; written < line.size();) {
+        ssize_t n = write(fd_, line.data() + written, line.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error(std::string("Cannot append a result: ") + std::strerror(errno));
+        written += n;
+    }
+    if (fsync(fd_) != 0) {
+        throw std::runtime_error(std::string("Cannot sync the results: ") + std::strerror(errno));
+    }
+}
+
+}  // namespace wallgo
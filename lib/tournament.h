@@ -0,0 +1,63 @@
+#ifndef WALLGO_TOURNAMENT_H
+#define WALLGO_TOURNAMENT_H
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace wallgo {
+
+// A pair of games between two participants with the same seed, first playing Red in the first game and second in the
+// second. Pairs cancel most of the color and seed bias, as in match.exe.
+struct WorkUnit {
+    int id;
+    int first, second;  // Indices of the participants
+    int seed;
+};
+
+struct GameResult {
+    PlayerColor winner;
+    Reason reason;
+    std::string game;  // Game string
+};
+
+struct UnitResult {
+    WorkUnit unit;
+    std::array<GameResult, 2> games;
+};
+
+// Every pairing of a round robin, or of the first participant against each other one in a gauntlet, repeated rounds
+// times. Unit i uses seed + i, so the schedule only depends on its arguments.
+std::vector<WorkUnit> make_schedule(int participants, bool gauntlet, int rounds, int seed);
+
+// A result as one line of text, without the newline, and back. parse_result returns nullopt if the line is malformed.
+std::string format_result(const UnitResult& result);
+std::optional<UnitResult> parse_result(const std::string& line);
+
+// An append-only file of unit results, one line each, after a header line that identifies the tournament. Every
+// append is flushed to disk before it returns, so a crash loses at most the line being written; a trailing partial
+// line is cut off when the file is opened again.
+class ResultsFile {
+   private:
+    int fd_ = -1;
+
+   public:
+    // Opens or creates the file and returns the results recorded so far in recorded. A new file gets header as its
+    // first line. Throws std::runtime_error if the file cannot be used or its header differs, i.e. it belongs to
+    // another tournament or is no results file at all; such a file is left as it was.
+    ResultsFile(const std::string& path, const std::string& header, std::vector<UnitResult>& recorded);
+    ~ResultsFile();
+
+    ResultsFile(const ResultsFile&) = delete;
+    ResultsFile& operator=(const ResultsFile&) = delete;
+
+    // Throws std::runtime_error if the line cannot be written.
+    void append(const UnitResult& result);
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_TOURNAMENT_H
@@ -0,0 +1,67 @@
+#ifndef WALLGO_TUNING_H
+#define WALLGO_TUNING_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace wallgo {
+
+// Constants of a player that a tuner may change. Players register their constants in Player::register_parameters by
+// reference, so every player instance can be given its own values.
+class ParameterRegistry {
+   public:
+    struct Parameter {
+        std::string name;
+        double value;  // As registered
+        double min, max;
+        double step;  // Smallest change worth testing; SPSA perturbs the parameter by about this much at the end
+        bool integer;
+    };
+
+   private:
+    std::vector<Parameter> parameters_;
+    std::vector<std::variant<int*, float*, double*>> targets_;
+
+   public:
+    // Registers value, which must outlive the registry, with the range it may be tuned in.
+    template <typename T>
+    void add(const std::string& name, T& value, double min, double max, double step) {
+        static_assert(std::is_same_v<T, int> || std::is_same_v<T, float> || std::is_same_v<T, double>,
+                      "Only int, float and double parameters can be tuned");
+        parameters_.push_back(Parameter{name, static_cast<double>(value), min, max, step, std::is_same_v<T, int>});
+        targets_.push_back(&value);
+    }
+
+    const std::vector<Parameter>& parameters() const { return parameters_; }
+
+    // Sets parameter i to value, clamped to its range and rounded if it is an integer.
+    void set(size_t i, double value) {
+        const Parameter& parameter = parameters_[i];
+        value = std::clamp(value, parameter.min, parameter.max);
+        std::visit(
+            [&](auto* target) {
+                using T = std::remove_pointer_t<decltype(target)>;
+                *target = std::is_same_v<T, int> ? static_cast<T>(std::lround(value)) : static_cast<T>(value);
+            },
+            targets_[i]);
+    }
+
+    // Sets the parameter with the given name. Returns false if there is none.
+    bool set(const std::string& name, double value) {
+        for (size_t i = 0; i < parameters_.size(); ++i) {
+            if (parameters_[i].name == name) {
+                set(i, value);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}  // namespace wallgo
+
+#endif  // WALLGO_TUNING_H
@@ -2,9 +2,13 @@
 
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <queue>
 #include <sstream>
 
+#include "geometry.h"
+#include "instrumentation.h"
+
 namespace wallgo {
 
 // Position implementation
@@ -57,64 +61,109 @@ std::optional<Direction> Move::direction2() const { return direction2_; }
 
 Direction Move::wall_placement_direction() const { return wall_placement_direction_; }
 
-std::string Move::encode() const {
-    unsigned int value = static_cast<unsigned int>(player_) - 1;
+std::string Move::encode() const { return PackedMove(*this).encode(); }
 
-    value <<= 3;
-    value |= piece_id_;
+Move Move::decode(const std::string &data) { return PackedMove::decode(data).unpack(); }
 
-    value <<= 3;
-    if (direction1_) value |= static_cast<unsigned int>(*direction1_) + 1;
+// PackedMove implementation
 
-    value <<= 3;
-    if (direction2_) value |= static_cast<unsigned int>(*direction2_) + 1;
+namespace {
 
-    value <<= 3;
-    value |= static_cast<unsigned int>(wall_placement_direction_) + 1;
+constexpr char DIGITS[] = "0123456789abcdefghijklmnopqrstuv";
 
-    std::string data;
-    for (int i = 0; i < 3; ++i) {
-        int part = value & 31;
-        data += part >= 10 ? 'a' + part - 10 : '0' + part;
-        value >>= 5;
+// Value of each character in encoded moves, -1 if it is not a digit.
+constexpr std::array<int8_t, 256> make_digit_values() {
+    std::array<int8_t, 256> values = {};
+    for (int ch = 0; ch < 256; ++ch) values[ch] = -1;
+    for (int i = 0; i < 32; ++i) values[static_cast<unsigned char>(DIGITS[i])] = static_cast<int8_t>(i);
+    return values;
+}
+
+// Whether each combination of the three direction fields, the low 9 bits, is valid: each field at most 4 and a wall.
+constexpr std::array<bool, 512> make_valid_directions() {
+    std::array<bool, 512> valid = {};
+    for (int bits = 0; bits < 512; ++bits) {
+        valid[bits] = (bits & 7) != 0 && (bits & 7) <= 4 && (bits >> 3 & 7) <= 4 && (bits >> 6 & 7) <= 4;
     }
+    return valid;
+}
+
+constexpr std::array<int8_t, 256> DIGIT_VALUES = make_digit_values();
+constexpr std::array<bool, 512> VALID_DIRECTIONS = make_valid_directions();
 
-    return data;
+}  // namespace
+
+PackedMove::PackedMove(const Move &move) {
+    unsigned int value = static_cast<unsigned int>(move.player()) - 1;
+    value = value << 3 | move.piece_id();
+    value = value << 3 | (move.direction1() ? static_cast<unsigned int>(*move.direction1()) + 1 : 0);
+    value = value << 3 | (move.direction2() ? static_cast<unsigned int>(*move.direction2()) + 1 : 0);
+    value = value << 3 | (static_cast<unsigned int>(move.wall_placement_direction()) + 1);
+    bits_ = static_cast<uint16_t>(value);
+}
+
+Move PackedMove::unpack() const {
+    return Move(player(), piece_id(), direction1(), direction2(), wall_placement_direction());
+}
+
+std::string PackedMove::encode() const {
+    return {DIGITS[bits_ & 31], DIGITS[bits_ >> 5 & 31], DIGITS[bits_ >> 10 & 31]};
+}
+
+PackedMove PackedMove::decode(const std::string &data) {
+    if (data.size() != 3) {
+        throw std::runtime_error("Encoded move must have 3 characters");
+    }
+    int digits[3];
+    for (int i = 0; i < 3; ++i) {
+        digits[i] = DIGIT_VALUES[static_cast<unsigned char>(data[i])];
+        if (digits[i] < 0) {
+            throw std::runtime_error("Invalid character in encoded move");
+        }
+    }
+    unsigned int value = digits[0] | digits[1] << 5 | digits[2] << 10;
+    if (!VALID_DIRECTIONS[value & 511] || value >> 13 != 0) {
+        throw std::runtime_error("Invalid encoded move");
+    }
+    return PackedMove(static_cast<uint16_t>(value));
 }
 
 // Board implementation
 
-Cell Board::get(Position pos) const {
-    if (pos.r < 0 || pos.r >= 7 || pos.c < 0 || pos.c >= 7) {
+template <int N>
+Cell BasicBoard<N>::get(Position pos) const {
+    if (pos.r < 0 || pos.r >= N || pos.c < 0 || pos.c >= N) {
         throw std::out_of_range("Position out of bounds");
     }
     return board_[pos.r][pos.c];
 }
 
-void Board::set(Cell c) {
+template <int N>
+void BasicBoard<N>::set(Cell c) {
     Position pos = c.pos();
-    if (pos.r < 0 || pos.r >= 7 || pos.c < 0 || pos.c >= 7) {
+    if (pos.r < 0 || pos.r >= N || pos.c < 0 || pos.c >= N) {
         throw std::out_of_range("Position out of bounds");
     }
     board_[pos.r][pos.c] = c;
 }
 
-std::vector<Cell> Board::get_accessible_neighbors(Position pos) const {
+template <int N>
+std::vector<Cell> BasicBoard<N>::get_accessible_neighbors(Position pos) const {
     std::vector<Cell> neighbors;
-    for (auto dir : {Direction::Up, Direction::Down, Direction::Left, Direction::Right}) {
-        Position neighbor_pos = pos.move(dir);
-        if (neighbor_pos.r >= 0 && neighbor_pos.r < 7 && neighbor_pos.c >= 0 && neighbor_pos.c < 7) {
-            if (get(pos).wall(dir) == WallType::None) {
-                neighbors.push_back(get(neighbor_pos));
-            }
+    const Cell &cell = get(pos);
+    for (int d = 0; d < 4; ++d) {
+        int neighbor = Geometry<N>::neighbor[pos.r * N + pos.c][d];
+        if (neighbor >= 0 && cell.wall(static_cast<Direction>(d)) == WallType::None) {
+            neighbors.push_back(board_[neighbor / N][neighbor % N]);
         }
     }
     return neighbors;
 }
 
-Piece Board::get_piece(PlayerColor player, PieceId pieceId) const {
-    for (int r = 0; r < 7; ++r) {
-        for (int c = 0; c < 7; ++c) {
+template <int N>
+Piece BasicBoard<N>::get_piece(PlayerColor player, PieceId pieceId) const {
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
             const Cell &cell = get({r, c});
             if (cell.piece() && cell.piece()->owner == player && cell.piece()->id == pieceId) {
                 return *cell.piece();
@@ -124,10 +173,11 @@ Piece Board::get_piece(PlayerColor player, PieceId pieceId) const {
     throw std::runtime_error("No piece with id exists");
 }
 
-std::vector<Piece> Board::get_pieces(PlayerColor player) const {
+template <int N>
+std::vector<Piece> BasicBoard<N>::get_pieces(PlayerColor player) const {
     std::vector<Piece> pieces;
-    for (int r = 0; r < 7; ++r) {
-        for (int c = 0; c < 7; ++c) {
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
             const Cell &cell = get({r, c});
             if (cell.piece() && cell.piece()->owner == player) {
                 pieces.push_back(*cell.piece());
@@ -138,13 +188,14 @@ std::vector<Piece> Board::get_pieces(PlayerColor player) const {
     return pieces;
 }
 
-Board::GetTerritoryResult Board::get_territory() const {
-    std::array<std::array<bool, 7>, 7> visited = {};
+template <int N>
+TerritoryResult BasicBoard<N>::get_territory() const {
+    std::array<std::array<bool, N>, N> visited = {};
 
     GetTerritoryResult res = {0, 0, 0, 0};
 
-    for (int r = 0; r < 7; ++r) {
-        for (int c = 0; c < 7; ++c) {
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
             if (visited[r][c]) continue;
 
             Cell cell = get({r, c});
@@ -190,10 +241,17 @@ Board::GetTerritoryResult Board::get_territory() const {
     }
     return res;
 }
-bool Board::is_move_legal(const Move &move) const {
-    Position pos = get_piece(move.player(), move.piece_id()).pos;
 
-    if (pos.r < 0 || pos.r >= 7 || pos.c < 0 || pos.c >= 7) {
+template <int N>
+bool BasicBoard<N>::is_move_legal(const Move &move) const {
+    std::vector<Piece> pieces = get_pieces(move.player());
+    auto piece = std::find_if(pieces.begin(), pieces.end(), [&](const Piece &p) { return p.id == move.piece_id(); });
+    if (piece == pieces.end()) {
+        return false;  // Player has no piece with this ID
+    }
+    Position pos = piece->pos;
+
+    if (pos.r < 0 || pos.r >= N || pos.c < 0 || pos.c >= N) {
         return false;  // Move is out of bounds
     }
 
@@ -222,10 +280,11 @@ bool Board::is_move_legal(const Move &move) const {
             return false;  // Cannot move through a wall
         }
 
-        Position new_pos = pos.move(dir);
-        if (new_pos.r < 0 || new_pos.r >= 7 || new_pos.c < 0 || new_pos.c >= 7) {
+        int next = Geometry<N>::neighbor[pos.r * N + pos.c][static_cast<int>(dir)];
+        if (next < 0) {
             return false;  // Move is out of bounds
         }
+        Position new_pos{next / N, next % N};
         if (get(new_pos).piece()) {
             return false;  // Cannot move to a cell that already has a piece
         }
@@ -239,50 +298,71 @@ bool Board::is_move_legal(const Move &move) const {
     return true;
 }
 
-std::vector<Move> Board::get_valid_moves(PlayerColor player) const {
+template <int N>
+std::vector<Move> BasicBoard<N>::get_valid_moves(PlayerColor player) const {
+    std::vector<PackedMove> packed = get_packed_moves(player);
     std::vector<Move> valid_moves;
-    Direction all_directions[] = {Direction::Up, Direction::Down, Direction::Left, Direction::Right};
+    valid_moves.reserve(packed.size());
+    for (PackedMove move : packed) {
+        valid_moves.push_back(move.unpack());
+    }
+    return valid_moves;
+}
 
-    for (int r = 0; r < 7; ++r) {
-        for (int c = 0; c < 7; ++c) {
-            const Cell &cell = get({r, c});
+template <int N>
+std::vector<PackedMove> BasicBoard<N>::get_packed_moves(PlayerColor player) const {
+    WALLGO_PHASE(movegen_seconds);
+    std::vector<PackedMove> valid_moves;
+    // Path bits of the packed move: direction1 + 1 and direction2 + 1, 0 for unused steps.
+    auto path_bits = [](const MovePath &path) { return (path.direction1 + 1) << 6 | (path.direction2 + 1) << 3; };
+
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
+            const Cell &cell = board_[r][c];
 
             if (!cell.piece() || cell.piece()->owner != player) {
                 continue;
             }
-            PieceId piece_id = cell.piece()->id;
+            unsigned int piece_bits = (static_cast<unsigned int>(player) - 1) << 12 | cell.piece()->id << 9;
+
+            // A path is open if no step crosses a wall or lands on a piece, as is_move_legal checks.
+            const MovePaths &paths = Geometry<N>::paths[r * N + c];
+            std::array<bool, MovePaths::MAX> open = {};
+            for (int i = 0; i < paths.count; ++i) {
+                const MovePath &path = paths.path[i];
+                const Cell &via = board_[path.via / N][path.via % N];
+                const Cell &target = board_[path.target / N][path.target % N];
+                open[i] = path.direction1 < 0 ||
+                          (cell.wall(static_cast<Direction>(path.direction1)) == WallType::None && !via.piece() &&
+                           (path.direction2 < 0 ||
+                            (via.wall(static_cast<Direction>(path.direction2)) == WallType::None && !target.piece())));
+            }
 
-            for (auto wall_dir : all_directions) {
-                Move move(player, piece_id, std::nullopt, std::nullopt, wall_dir);
-                if (is_move_legal(move)) {
-                    valid_moves.push_back(move);
-                }
-
-                for (auto dir1 : all_directions) {
-                    Move move(player, piece_id, dir1, std::nullopt, wall_dir);
-                    if (is_move_legal(move)) {
-                        valid_moves.push_back(move);
-                    }
-                    for (auto dir2 : all_directions) {
-                        Move move(player, piece_id, dir1, dir2, wall_dir);
-                        if (is_move_legal(move)) {
-                            valid_moves.push_back(move);
-                        }
-                    }
+            // Moves are listed by wall direction, then by path, as they always have been.
+            for (int wall_dir = 0; wall_dir < 4; ++wall_dir) {
+                for (int i = 0; i < paths.count; ++i) {
+                    const MovePath &path = paths.path[i];
+                    const Cell &target = board_[path.target / N][path.target % N];
+                    if (!open[i] || target.wall(static_cast<Direction>(wall_dir)) != WallType::None) continue;
+                    valid_moves.emplace_back(static_cast<uint16_t>(piece_bits | path_bits(path) | (wall_dir + 1)));
                 }
             }
         }
     }
 
+    WALLGO_COUNT(expanded, 1);
+    WALLGO_COUNT(children, valid_moves.size());
     return valid_moves;
 }
 
-Board Board::apply_move(const Move &move) const {
+template <int N>
+BasicBoard<N> BasicBoard<N>::apply_move(const Move &move) const {
     if (!is_move_legal(move)) {
         throw std::runtime_error("Illegal move");
     }
 
-    Board new_board = *this;
+    WALLGO_COUNT(nodes, 1);
+    BasicBoard new_board = *this;
 
     Position pos = get_piece(move.player(), move.piece_id()).pos, new_pos = pos;
     Piece piece = *new_board.get(pos).piece();
@@ -314,9 +394,10 @@ Board Board::apply_move(const Move &move) const {
     return new_board;
 }
 
-bool Board::is_game_over() const {
+template <int N>
+bool BasicBoard<N>::is_game_over() const {
     // check if any red pieces can reach blue pieces
-    std::array<std::array<bool, 7>, 7> visited = {};
+    std::array<std::array<bool, N>, N> visited = {};
 
     for (auto piece : get_pieces(PlayerColor::Red)) {
         Position pos = piece.pos;
@@ -346,32 +427,53 @@ bool Board::is_game_over() const {
 }
 
 // Game implementation
-Game::Game() : board_(), history_() {
-    for (int r = 0; r < 7; ++r) {
-        for (int c = 0; c < 7; ++c) {
+template <int N>
+BasicGame<N>::BasicGame() : board_(), history_() {
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
             board_.set(Cell({r, c}, std::nullopt,
-                            {r == 0 ? WallType::Border : WallType::None, r == 6 ? WallType::Border : WallType::None,
-                             c == 0 ? WallType::Border : WallType::None, c == 6 ? WallType::Border : WallType::None}));
+                            {r == 0 ? WallType::Border : WallType::None,
+                             r == N - 1 ? WallType::Border : WallType::None,
+                             c == 0 ? WallType::Border : WallType::None,
+                             c == N - 1 ? WallType::Border : WallType::None}));
         }
     }
 }
 
-Board Game::board() const { return board_; }
+template <int N>
+BasicBoard<N> BasicGame<N>::board() const { return board_; }
 
-std::vector<Move> Game::history() const { return history_; }
+template <int N>
+std::vector<Move> BasicGame<N>::history() const {
+    std::vector<Move> history;
+    history.reserve(history_.size());
+    for (PackedMove move : history_) {
+        history.push_back(move.unpack());
+    }
+    return history;
+}
 
-void Game::apply_move(Move move) {
+template <int N>
+const std::vector<PackedMove> &BasicGame<N>::packed_history() const { return history_; }
+
+template <int N>
+std::vector<Piece> BasicGame<N>::placements() const { return placements_; }
+
+template <int N>
+void BasicGame<N>::apply_move(Move move) {
     board_ = board_.apply_move(move);
-    history_.push_back(move);
+    history_.push_back(PackedMove(move));
 }
 
-void Game::place_piece(Position pos, PlayerColor player, PieceId piece_id) {
+template <int N>
+void BasicGame<N>::place_piece(Position pos, PlayerColor player, PieceId piece_id) {
     Piece piece{player, pos, piece_id};
     board_.set(Cell(pos, piece, board_.get(pos).walls()));
     placements_.push_back(piece);
 }
 
-std::string Game::encode() const {
+template <int N>
+std::string BasicGame<N>::encode() const {
     std::string s;
     for (const auto &piece : placements_) {
         std::stringstream ss;
@@ -379,12 +481,82 @@ std::string Game::encode() const {
         s += ss.str();
     }
     s += '_';
-    for (const auto &move : history_) {
+    for (PackedMove move : history_) {
         s += move.encode();
     }
     return s;
 }
 
+template <int N>
+BasicGame<N> BasicGame<N>::decode(const std::string &encoded) {
+    size_t separator = encoded.find('_');
+    if (separator == std::string::npos || separator % 4 != 0 || (encoded.size() - separator - 1) % 3 != 0) {
+        throw std::runtime_error("Malformed game string");
+    }
+
+    BasicGame game;
+    for (size_t i = 0; i < separator; i += 4) {
+        for (size_t j = i; j < i + 4; ++j) {
+            if (encoded[j] < '0' || encoded[j] > '9') {
+                throw std::runtime_error("Malformed placement in game string");
+            }
+        }
+        Position pos{encoded[i] - '0', encoded[i + 1] - '0'};
+        int owner = encoded[i + 2] - '0';
+        if (owner != 1 && owner != 2) {
+            throw std::runtime_error("Malformed placement in game string");
+        }
+        game.place_piece(pos, static_cast<PlayerColor>(owner), encoded[i + 3] - '0');
+    }
+    for (size_t i = separator + 1; i < encoded.size(); i += 3) {
+        game.apply_move(Move::decode(encoded.substr(i, 3)));
+    }
+    return game;
+}
+
+SearchStats &SearchStats::operator+=(const SearchStats &other) {
+    nodes += other.nodes;
+    expanded += other.expanded;
+    children += other.children;
+    evaluations += other.evaluations;
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    depth = std::max(depth, other.depth);
+    movegen_seconds += other.movegen_seconds;
+    bfs_seconds += other.bfs_seconds;
+    eval_seconds += other.eval_seconds;
+    return *this;
+}
+
+std::pair<PlayerColor, Reason> decide_winner(const TerritoryResult &territory, PlayerColor last_mover) {
+    if (territory.red_total != territory.blue_total) {
+        return {territory.red_total > territory.blue_total ? PlayerColor::Red : PlayerColor::Blue, BY_TOTAL_AREA};
+    }
+    if (territory.red_max != territory.blue_max) {
+        return {territory.red_max > territory.blue_max ? PlayerColor::Red : PlayerColor::Blue, BY_LARGEST_AREA};
+    }
+    return {last_mover == PlayerColor::Red ? PlayerColor::Blue : PlayerColor::Red, BY_LAST_PLACEMENT};
+}
+
+const DecisionTime *PlayerTiming::slowest() const {
+    if (decisions.empty()) return nullptr;
+    return &*std::max_element(decisions.begin(), decisions.end(),
+                              [](const DecisionTime &a, const DecisionTime &b) { return a.time < b.time; });
+}
+
+double PlayerTiming::min_remaining() const {
+    double least = std::numeric_limits<double>::infinity();
+    for (const DecisionTime &decision : decisions) {
+        least = std::min(least, decision.remaining);
+    }
+    return least;
+}
+
+template class BasicBoard<7>;
+template class BasicBoard<5>;
+template class BasicGame<7>;
+template class BasicGame<5>;
+
 }  // namespace wallgo
 
 namespace std {
@@ -396,10 +568,11 @@ ostream &operator<<(ostream &os, const wallgo::Move &move) {
        << ", wall_placement_direction=" << static_cast<int>(move.wall_placement_direction()) << ")";
     return os;
 }
-ostream &operator<<(ostream &os, const wallgo::Board &board) {
+template <int N>
+ostream &operator<<(ostream &os, const wallgo::BasicBoard<N> &board) {
     using namespace wallgo;
-    for (int r = 0; r < 7; ++r) {
-        for (int c = 0; c < 7; ++c) {
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
             const Cell &cell = board.get({r, c});
             os << '+';
             if (cell.wall(Direction::Up) != WallType::None) {
@@ -409,7 +582,7 @@ ostream &operator<<(ostream &os, const wallgo::Board &board) {
             }
         }
         os << "+\n";
-        for (int c = 0; c < 7; ++c) {
+        for (int c = 0; c < N; ++c) {
             const Cell &cell = board.get({r, c});
             if (cell.wall(Direction::Left) != WallType::None) {
                 os << '|';
@@ -430,8 +603,8 @@ ostream &operator<<(ostream &os, const wallgo::Board &board) {
         }
         cout << "|\n";
     }
-    for (int c = 0; c < 7; ++c) {
-        const Cell &cell = board.get({6, c});
+    for (int c = 0; c < N; ++c) {
+        const Cell &cell = board.get({N - 1, c});
         os << '+';
         if (cell.wall(Direction::Down) != WallType::None) {
             os << "---";
@@ -443,4 +616,7 @@ ostream &operator<<(ostream &os, const wallgo::Board &board) {
     return os;
 }
 
+template ostream &operator<<(ostream &os, const wallgo::BasicBoard<7> &board);
+template ostream &operator<<(ostream &os, const wallgo::BasicBoard<5> &board);
+
 }  // namespace std
\ No newline at end of file
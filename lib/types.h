@@ -2,10 +2,13 @@
 #define WALLGO_TYPES_H
 
 #include <array>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -15,6 +18,10 @@ using PieceId = int;
 
 enum class PlayerColor { Red = 1, Blue = 2 };
 
+inline PlayerColor opponent_of(PlayerColor player) {
+    return player == PlayerColor::Red ? PlayerColor::Blue : PlayerColor::Red;
+}
+
 enum class Direction { Up = 0, Down = 1, Left = 2, Right = 3 };
 
 enum class WallType { None = 0, PlayerRed = 1, PlayerBlue = 2, Border = 3 };
@@ -84,15 +91,62 @@ class Move {
 
     // Encode move as string
     std::string encode() const;
+
+    // Decodes a 3-character string produced by encode. Throws std::runtime_error if the data is malformed.
+    static Move decode(const std::string& data);
+};
+
+// A Move in 16 bits, for move lists, histories and hash table entries. The bits are the value behind Move::encode:
+// the wall direction + 1 in bits 0-2, direction2 + 1 (0 if none) in bits 3-5, direction1 + 1 in bits 6-8, the piece
+// id in bits 9-11 and the player - 1 in bit 12. The default value, 0, is not a valid move and can mark an empty slot.
+class PackedMove {
+   private:
+    uint16_t bits_ = 0;
+
+    static constexpr std::optional<Direction> direction(unsigned int field) {
+        if (field == 0) return std::nullopt;
+        return static_cast<Direction>(field - 1);
+    }
+
+   public:
+    constexpr PackedMove() = default;
+    constexpr explicit PackedMove(uint16_t bits) : bits_(bits) {}
+    explicit PackedMove(const Move& move);
+
+    constexpr uint16_t bits() const { return bits_; }
+    constexpr PlayerColor player() const { return static_cast<PlayerColor>((bits_ >> 12 & 1) + 1); }
+    constexpr PieceId piece_id() const { return bits_ >> 9 & 7; }
+    constexpr std::optional<Direction> direction1() const { return direction(bits_ >> 6 & 7); }
+    constexpr std::optional<Direction> direction2() const { return direction(bits_ >> 3 & 7); }
+    constexpr Direction wall_placement_direction() const { return static_cast<Direction>((bits_ & 7) - 1); }
+
+    Move unpack() const;
+
+    // Same as Move::encode and Move::decode, by table lookup.
+    std::string encode() const;
+    static PackedMove decode(const std::string& data);
+
+    constexpr bool operator==(PackedMove other) const { return bits_ == other.bits_; }
+};
+
+static_assert(sizeof(PackedMove) == 2 && std::is_trivially_copyable_v<PackedMove>);
+
+// Total area controlled by each player and the maximum area of a single piece for each player.
+struct TerritoryResult {
+    int red_total, red_max, blue_total, blue_max;
 };
 
-// Represents the game board, which is a 7x7 grid of cells.
-class Board {
+// Represents the game board, which is an N x N grid of cells. The game is played on Board, the 7x7 board; smaller
+// boards make exhaustive tests of search code feasible. Neighbours and move paths come from the tables of Geometry<N>.
+template <int N>
+class BasicBoard {
    private:
-    std::array<std::array<Cell, 7>, 7> board_;
+    std::array<std::array<Cell, N>, N> board_;
 
    public:
-    Board() = default;
+    static constexpr int SIZE = N;
+
+    BasicBoard() = default;
 
     // Gets the cell at the specified position. If the position is out of bounds, throws std::out_of_range.
     Cell get(Position pos) const;
@@ -109,9 +163,7 @@ class Board {
     std::vector<Piece> get_pieces(PlayerColor player) const;
 
     // Returns the total area controlled by each player and the maximum area of a single piece for each player.
-    struct GetTerritoryResult {
-        int red_total, red_max, blue_total, blue_max;
-    };
+    using GetTerritoryResult = TerritoryResult;
     GetTerritoryResult get_territory() const;
 
     // Checks if the move is legal according to the game rules.
@@ -120,30 +172,40 @@ class Board {
     // Returns a list of valid moves for the specified player.
     std::vector<Move> get_valid_moves(PlayerColor player) const;
 
+    // The same moves, in the same order, packed into 2 bytes each.
+    std::vector<PackedMove> get_packed_moves(PlayerColor player) const;
+
     // Returns a new Board instance with the updated state after applying the move.
     // The move must be legal, otherwise it throws std::runtime_error.
     // The move DOES NOT modify the current Board instance.
-    Board apply_move(const Move& move) const;
+    BasicBoard apply_move(const Move& move) const;
 
     // Checks if the game is over according to the game rules.
     bool is_game_over() const;
 };
 
+using Board = BasicBoard<7>;
+
 // Represents the game state, including the board, piece placements, and move history.
-class Game {
+template <int N>
+class BasicGame {
    private:
-    Board board_;
+    BasicBoard<N> board_;
     std::vector<Piece> placements_;
-    std::vector<Move> history_;
+    std::vector<PackedMove> history_;
 
    public:
-    Game();
+    BasicGame();
 
     // Returns the board of the game.
-    Board board() const;
+    BasicBoard<N> board() const;
 
     // Returns the history of moves made in the game.
     std::vector<Move> history() const;
+    const std::vector<PackedMove>& packed_history() const;
+
+    // Returns the pieces in the order they were placed.
+    std::vector<Piece> placements() const;
 
     // Places a piece at the specified position for the specified player with the given piece ID.
     // This updates the board and adds the piece to the placements list.
@@ -155,6 +217,40 @@ class Game {
 
     // Encodes the game state as a string, which includes the board and move history.
     std::string encode() const;
+
+    // Rebuilds a game from a string produced by encode by replaying its placements and moves.
+    // Throws std::runtime_error if the string is malformed or contains an illegal move.
+    static BasicGame decode(const std::string& encoded);
+};
+
+using Game = BasicGame<7>;
+
+// Statistics about the search behind one decision. The controller collects the counters that library code records
+// while a player decides (see instrumentation.h) and adds whatever the player reports through Player::search_stats.
+struct SearchStats {
+    uint64_t nodes = 0;        // Positions visited
+    uint64_t expanded = 0;     // Positions whose moves were generated
+    uint64_t children = 0;     // Moves generated over all expanded positions
+    uint64_t evaluations = 0;  // Positions scored by an evaluation function
+    uint64_t tt_probes = 0;    // Transposition table lookups
+    uint64_t tt_hits = 0;      // Lookups that found an entry
+    int depth = 0;             // Deepest search iteration completed
+    double movegen_seconds = 0;
+    double bfs_seconds = 0;
+    double eval_seconds = 0;  // Scoring distance fields and other evaluation work, excluding BFS
+
+    SearchStats& operator+=(const SearchStats& other);
+};
+
+class ParameterRegistry;
+struct GameOutcome;
+
+// Limits the controller sets for the next place or move decision of a player.
+struct SearchLimits {
+    double remaining;  // Seconds left on the player's clock
+    double increment;  // Seconds added to the clock after the decision
+    uint64_t nodes;    // If nonzero, search at most this many nodes and ignore the clock, for reproducible games
+    int depth = 0;     // If nonzero, search this many plies deep and ignore the clock; only benchmarks set it
 };
 
 // Abstract interface for players in the game which you should implement.
@@ -176,6 +272,34 @@ class Player {
     // Return the move you want to make.
     virtual Move move(const std::vector<Move>& valid_moves) = 0;
 
+    // Optionally override this method to learn the limits of the next decision. It is called before every place and
+    // move.
+    virtual void set_limits(const SearchLimits& limits) {}
+
+    // Optionally override these methods to follow the game incrementally, e.g. to advance a search tree or hash key
+    // instead of rescanning the history. They are called for the placements and moves of both players, including
+    // this one's, after the action has been applied to the game passed to init and before the next decision. The time
+    // they take is charged to this player's clock.
+    virtual void on_placement(const Piece& piece) {}
+    virtual void on_move(const Move& move) {}
+
+    // Optionally override this method to learn how the game ended. It is called once, after the last decision, and is
+    // not timed.
+    virtual void on_game_over(const GameOutcome& outcome) {}
+
+    // Optionally override this method to expose constants for tuning by registering them with registry.add, see
+    // tuning.h. Tuners call it before init and may then change the values.
+    virtual void register_parameters(ParameterRegistry& registry) {}
+
+    // Optionally override this method to report statistics about the search behind the last place or move decision,
+    // such as the depth reached or transposition table hits. Return nullptr to report nothing.
+    virtual const SearchStats* search_stats() const { return nullptr; }
+
+    // Optionally override this method to have the last timed call, i.e. init, a place or move decision, or on_placement
+    // or on_move, charged this many seconds instead of the wall time the controller measured, e.g. the CPU time of a
+    // player in its own process. Return nullopt to be charged wall time.
+    virtual std::optional<double> charged_seconds() const { return std::nullopt; }
+
     // Virtual destructor to ensure proper cleanup of derived classes. No need to care.
     virtual ~Player() = default;
 };
@@ -188,18 +312,54 @@ enum Reason {
     OPPONENT_ILLEGAL_MOVE
 };
 
+// Time taken by one decision of a player, in seconds.
+struct DecisionTime {
+    int ply;           // 0 to 7 for placements, then one per move
+    double time;       // Seconds charged: wall time since the previous event, or Player::charged_seconds
+    double remaining;  // Budget left after the decision was charged, as the controller counts it
+};
+
+// Time one player spent over a game, in seconds.
+struct PlayerTiming {
+    double init_time = 0;
+    double placement_time = 0;
+    double movement_time = 0;
+    std::vector<DecisionTime> decisions;  // In order of play
+
+    // Returns the decision that took longest, or nullptr if there were none.
+    const DecisionTime* slowest() const;
+
+    // Returns the least budget left after any decision, which is how close the player came to OPPONENT_TLE.
+    double min_remaining() const;
+};
+
 struct GameOutcome {
     PlayerColor winner;
     Reason reason;
     std::string encoded_game;
     std::string message;
+    std::array<PlayerTiming, 3> timing;  // Indexed by player number; timing[0] is unused
 };
 
+// Thrown by Player::place or Player::move to give up the game instead of deciding, e.g. when the process behind the
+// player died or overran its time. The controller records reason as the way the player lost.
+class Forfeit : public std::runtime_error {
+   public:
+    Reason reason;
+
+    Forfeit(Reason reason, const std::string& message) : std::runtime_error(message), reason(reason) {}
+};
+
+// Decides a finished game: the larger total area wins, then the larger single area, and if both tie the player who
+// did NOT make the last move wins. Returns the winner and the reason.
+std::pair<PlayerColor, Reason> decide_winner(const TerritoryResult& territory, PlayerColor last_mover);
+
 }  // namespace wallgo
 
 namespace std {
 ostream& operator<<(ostream& os, const wallgo::Move& move);
-ostream& operator<<(ostream& os, const wallgo::Board& board);
+template <int N>
+ostream& operator<<(ostream& os, const wallgo::BasicBoard<N>& board);
 }  // namespace std
 
 #endif  // WALLGO_TYPES_H
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "zobrist.h"
+
+namespace wallgo {
+namespace zobrist {
+
+namespace {
+
+struct Keys {
+    std::array<std::array<uint64_t, 49>, 2> piece;
+    std::array<uint64_t, EDGE_COUNT> wall;
+    uint64_t side;
+};
+
+// splitmix64, so the keys are fixed across builds and machines.
+constexpr uint64_t next_key(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys make_keys() {
+    Keys keys{};
+    uint64_t state = 0x77a11a0a2025ULL;
+    for (auto& color : keys.piece) {
+        for (auto& key : color) key = next_key(state);
+    }
+    for (auto& key : keys.wall) key = next_key(state);
+    keys.side = next_key(state);
+    return keys;
+}
+
+constexpr Keys KEYS = make_keys();
+
+}  // namespace
+
+int edge_index(Position pos, Direction d) { return Geometry<7>::edge[pos.r * 7 + pos.c][static_cast<int>(d)]; }
+
+uint64_t piece_key(PlayerColor color, Position pos) {
+    return KEYS.piece[static_cast<int>(color) - 1][pos.r * 7 + pos.c];
+}
+
+uint64_t wall_key(Position pos, Direction d) {
+    int edge = edge_index(pos, d);
+    return edge < 0 ? 0 : KEYS.wall[edge];
+}
+
+uint64_t side_key() { return KEYS.side; }
+
+uint64_t hash(const Board& board) {
+    uint64_t h = 0;
+    for (int r = 0; r < 7; ++r) {
+        for (int c = 0; c < 7; ++c) {
+            Cell cell = board.get({r, c});
+            if (cell.piece()) {
+                h ^= piece_key(cell.piece()->owner, {r, c});
+            }
+            // Each interior edge is seen from both of its cells; only count it from the lower/right side.
+            if (cell.wall(Direction::Down) != WallType::None) h ^= wall_key({r, c}, Direction::Down);
+            if (cell.wall(Direction::Right) != WallType::None) h ^= wall_key({r, c}, Direction::Right);
+        }
+    }
+    return h;
+}
+
+uint64_t hash(const Board& board, PlayerColor to_act) {
+    return hash(board) ^ (to_act == PlayerColor::Blue ? side_key() : 0);
+}
+
+}  // namespace zobrist
+}  // namespace wallgo
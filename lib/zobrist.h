@@ -0,0 +1,42 @@
+#ifndef WALLGO_ZOBRIST_H
+#define WALLGO_ZOBRIST_H
+
+#include <array>
+#include <cstdint>
+
+#include "geometry.h"
+#include "types.h"
+
+namespace wallgo {
+
+// Zobrist hashing of board positions. Only what affects the rest of the game is hashed: the color of the piece on
+// each cell and whether each interior edge carries a wall. Piece ids and wall owners are ignored, so positions that
+// differ only in those details share a key.
+namespace zobrist {
+
+// Number of interior edges on the 7x7 board: 7 * 6 between horizontal neighbours and 6 * 7 between vertical ones.
+constexpr int EDGE_COUNT = Geometry<7>::EDGES;
+
+// Returns the index of the edge on side d of the cell at pos, or -1 if that side is the border.
+int edge_index(Position pos, Direction d);
+
+// Key toggled in or out when a piece of the given color occupies pos.
+uint64_t piece_key(PlayerColor color, Position pos);
+
+// Key toggled in when a wall is placed on side d of the cell at pos. Both cells sharing the edge give the same key.
+uint64_t wall_key(Position pos, Direction d);
+
+// Key mixed in when Blue is the player to act.
+uint64_t side_key();
+
+// Hashes the pieces and walls on the board from scratch.
+uint64_t hash(const Board& board);
+
+// Hashes the position together with the player to act.
+uint64_t hash(const Board& board, PlayerColor to_act);
+
+}  // namespace zobrist
+
+}  // namespace wallgo
+
+#endif  // WALLGO_ZOBRIST_H
@@ -7,6 +7,7 @@
 #ifdef ONLINE_JUDGE
 #include "aicomp.h"
 #else
+#include "../lib/tuning.h"
 #include "../lib/types.h"
 #endif
 
@@ -19,7 +20,19 @@ class RedPlayerImpl : public Player {
     std::mt19937 rng_;
     std::shared_ptr<const Game> game;
 
+    double control_decay_ = 1;        // Control of a piece over a cell d steps away is exp(-control_decay_ * d)
+    double territory_exponent_ = 2;   // Sealed territory is scored as its size to this power
+    double territory_weight_ = 100;   // Weight of the cubed difference of scored territory
+
    public:
+#ifndef ONLINE_JUDGE
+    void register_parameters(ParameterRegistry& registry) override {
+        registry.add("control_decay", control_decay_, 0.1, 3, 0.1);
+        registry.add("territory_exponent", territory_exponent_, 0.5, 3, 0.1);
+        registry.add("territory_weight", territory_weight_, 0, 1000, 10);
+    }
+#endif
+
     void init(PlayerColor player, std::shared_ptr<const Game> game_, int seed) override {
         rng_ = std::mt19937(seed);
         game = game_;
@@ -100,14 +113,14 @@ class RedPlayerImpl : public Player {
                 // Sum red control
                 for (const auto& dist : red_distances) {
                     if (dist[r][c] != -1) {
-                        red_control += exp(-dist[r][c]);
+                        red_control += exp(-control_decay_ * dist[r][c]);
                     }
                 }
 
                 // Sum blue control
                 for (const auto& dist : blue_distances) {
                     if (dist[r][c] != -1) {
-                        blue_control += exp(-dist[r][c]);
+                        blue_control += exp(-control_decay_ * dist[r][c]);
                     }
                 }
 
@@ -117,9 +130,9 @@ class RedPlayerImpl : public Player {
 
         // Penalise opponent from claming territory
 
-        double red = std::pow(board.get_territory().red_total, 2);
-        double blue = std::pow(board.get_territory().blue_total, 2);
-        ans += pow(red - blue, 3) * 100;
+        double red = std::pow(board.get_territory().red_total, territory_exponent_);
+        double blue = std::pow(board.get_territory().blue_total, territory_exponent_);
+        ans += pow(red - blue, 3) * territory_weight_;
         // std::cout << "Penalty: " << board.get_territory().blue_total << std::endl;
         return ans;
     }
@@ -4,6 +4,7 @@
 #ifdef ONLINE_JUDGE
 #include "aicomp.h"
 #else
+#include "../lib/tuning.h"
 #include "../lib/types.h"
 #endif
 
@@ -39,16 +40,17 @@ class EthenImpl : public Player {
 		}
 	}
 
-	const float GURANTEED_SELF_WIN_SCORE = 0.9;
-	const float GURANTEED_OPPONENT_WIN_SCORE = -0.85;
+	// Not const so that they can be tuned, see register_parameters.
+	float GURANTEED_SELF_WIN_SCORE = 0.9;
+	float GURANTEED_OPPONENT_WIN_SCORE = -0.85;
 
-	const float SEMI_GURANTEED_SELF_WIN_SCORE = 0.8;
-	const float SEMI_GURANTEED_OPPONENT_WIN_SCORE = -0.75;
+	float SEMI_GURANTEED_SELF_WIN_SCORE = 0.8;
+	float SEMI_GURANTEED_OPPONENT_WIN_SCORE = -0.75;
 
-	const int CONSIDER_BOUNDARY = 6;
-	const float NOT_GUARANTEED_WEIGHTING = 0.90;
+	int CONSIDER_BOUNDARY = 6;
+	float NOT_GUARANTEED_WEIGHTING = 0.90;
 
-	const int TOP_K = 5;
+	int TOP_K = 5;
 
 	float lookup_score(int dist_player, int dist_opponent) {
 		if (dist_player == dist_opponent) return 0.0;
@@ -98,6 +100,18 @@ class EthenImpl : public Player {
 	}
 
    public:
+#ifndef ONLINE_JUDGE
+    void register_parameters(ParameterRegistry& registry) override {
+        registry.add("GURANTEED_SELF_WIN_SCORE", GURANTEED_SELF_WIN_SCORE, 0, 2, 0.05);
+        registry.add("GURANTEED_OPPONENT_WIN_SCORE", GURANTEED_OPPONENT_WIN_SCORE, -2, 0, 0.05);
+        registry.add("SEMI_GURANTEED_SELF_WIN_SCORE", SEMI_GURANTEED_SELF_WIN_SCORE, 0, 2, 0.05);
+        registry.add("SEMI_GURANTEED_OPPONENT_WIN_SCORE", SEMI_GURANTEED_OPPONENT_WIN_SCORE, -2, 0, 0.05);
+        registry.add("CONSIDER_BOUNDARY", CONSIDER_BOUNDARY, 2, 12, 1);
+        registry.add("NOT_GUARANTEED_WEIGHTING", NOT_GUARANTEED_WEIGHTING, 0, 2, 0.05);
+        registry.add("TOP_K", TOP_K, 1, 20, 1);
+    }
+#endif
+
     void init(PlayerColor player, std::shared_ptr<const Game> game, int seed) override {
         rng.seed(seed);
         this->game = game;
@@ -0,0 +1,434 @@
+// Replays archived game strings and evaluates every move.
+//
+//   analyze.exe [options] [file]     reads one game string per line (stdin if no file)
+//
+// Options:
+//   --engine <name>     evaluator used to score positions (default ratio)
+//   --depth <1|2>       1 scores each move by the position it leads to, 2 also minimizes over the replies
+//   --threads <n>       number of worker threads (default: all cores)
+//   --blunder <loss>    flag moves that lose at least this much against the best move (default 3)
+//   --format <csv|jsonl>
+//   --solve <nodes>     also try to prove the result of every position with up to this many nodes each (default 0: off)
+//   --hash <mb>         transposition table of each thread's solver (default 64)
+//
+// For every move it prints the score of the best and the played move from the mover's point of view, the loss and
+// a blunder flag, and the static score for Red after the move. For every game it prints the outcome, the decisive
+// move (the move after which the eventual winner stayed ahead), and when pieces got sealed off from all opponents.
+// Summary statistics go to stderr.
+//
+// With --solve, positions are solved from the last one backwards with the proof-number solver (lib/solver.h), until
+// one cannot be proven within the budget. Every solved move gets the proof for the mover before it and whether it
+// threw away a proven win; every game gets the first move from which every position was proven.
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "evaluation.h"
+#include "regions.h"
+#include "solver.h"
+#include "types.h"
+
+using namespace wallgo;
+
+namespace {
+
+const char* REASON_NAMES[] = {"total", "largest", "last", "tle", "illegal"};
+const char* PROOF_NAMES[] = {"", "win", "loss"};
+
+struct Options {
+    std::string engine = "ratio";
+    int depth = 1;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    double blunder = 3;
+    bool jsonl = false;
+    uint64_t solve = 0;
+    size_t hash = 64;
+    std::string input;
+};
+
+struct MoveAnalysis {
+    Move move;
+    double best, played, red_eval;
+    bool blunder, decisive;
+    Proof proof = Proof::Unknown;  // For the mover, before the move
+    bool lost_win = false;         // The mover had a proven win and the move lets the opponent prove one
+};
+
+struct GameAnalysis {
+    std::vector<MoveAnalysis> moves;
+    PlayerColor winner;
+    Reason reason;
+    Board::GetTerritoryResult territory;
+    int decisive_move = -1;  // 1-based, -1 if the winner was never ahead at the end
+    int first_separation;    // Move number at which the first piece got sealed off
+    double mean_separation;  // Average over pieces of the move number at which each got sealed off
+    int blunders[3] = {};    // Indexed by PlayerColor
+    int proven_move = -1;    // 1-based first move from which every position was proven, -1 if none or not solving
+    int lost_wins = 0;
+};
+
+const char* color_name(PlayerColor player) { return player == PlayerColor::Red ? "red" : "blue"; }
+
+// Scores of the positions after each move, from the mover's point of view.
+std::vector<double> score_moves(Evaluator& evaluator, const Board& board, const std::vector<Move>& moves,
+                                PlayerColor mover, int depth) {
+    if (depth <= 1) return evaluator.evaluate_children(board, moves, mover);
+    std::vector<double> scores;
+    for (const Move& move : moves) {
+        Board child = board.apply_move(move);
+        if (child.is_game_over()) {
+            scores.push_back(evaluator.evaluate(child, mover));
+            continue;
+        }
+        std::vector<double> replies =
+            evaluator.evaluate_children(child, child.get_valid_moves(opponent_of(mover)), mover);
+        scores.push_back(*std::min_element(replies.begin(), replies.end()));
+    }
+    return scores;
+}
+
+GameAnalysis analyze_game(const std::string& encoded, Evaluator& evaluator, ProofSolver* solver,
+                          const Options& options) {
+    Game game = Game::decode(encoded);
+    GameAnalysis result;
+
+    Game replay;
+    for (const Piece& piece : game.placements()) {
+        replay.place_piece(piece.pos, piece.owner, piece.id);
+    }
+    RegionMap regions(replay.board());
+
+    std::vector<Move> history = game.history();
+    std::vector<Board> positions;  // Before each move, kept for the solver
+    // Move number at which each piece got sealed off, indexed by color and id; 0 while still in contact.
+    int sealed[3][4] = {};
+    result.first_separation = static_cast<int>(history.size());
+
+    for (size_t i = 0; i < history.size(); ++i) {
+        const Move& move = history[i];
+        Board board = replay.board();
+        if (solver) positions.push_back(board);
+        std::vector<double> scores =
+            score_moves(evaluator, board, board.get_valid_moves(move.player()), move.player(), options.depth);
+        double best = *std::max_element(scores.begin(), scores.end());
+        double played = score_moves(evaluator, board, {move}, move.player(), options.depth)[0];
+
+        replay.apply_move(move);
+        regions.apply(board, move);
+        Board after = replay.board();
+        bool blunder = best - played >= options.blunder;
+        result.blunders[static_cast<int>(move.player())] += blunder;
+        result.moves.push_back({move, best, played, evaluator.evaluate(after, PlayerColor::Red), blunder, false});
+
+        for (PlayerColor color : {PlayerColor::Red, PlayerColor::Blue}) {
+            for (const Piece& piece : after.get_pieces(color)) {
+                int& when = sealed[static_cast<int>(color)][piece.id];
+                if (when == 0 && regions.locked(piece.pos)) {
+                    when = static_cast<int>(i) + 1;
+                    result.first_separation = std::min(result.first_separation, when);
+                }
+            }
+        }
+    }
+
+    Board final_board = replay.board();
+    result.territory = final_board.get_territory();
+    size_t placed = game.placements().size();
+    PlayerColor to_act = history.size() % 2 == 0 ? PlayerColor::Red : PlayerColor::Blue;
+    if (placed < 8) {
+        to_act = (placed == 0 || placed == 3 || placed == 4 || placed == 7) ? PlayerColor::Red : PlayerColor::Blue;
+    }
+    if (placed < 8 || !final_board.is_game_over()) {
+        // The string does not say whether the player to act timed out or made an illegal move.
+        result.winner = opponent_of(to_act);
+        result.reason = OPPONENT_TLE;
+    } else {
+        std::tie(result.winner, result.reason) = decide_winner(result.territory, opponent_of(to_act));
+    }
+
+    int total = 0;
+    for (int color = 1; color <= 2; ++color) {
+        for (int id = 0; id < 4; ++id) {
+            total += sealed[color][id] ? sealed[color][id] : static_cast<int>(history.size());
+        }
+    }
+    result.mean_separation = total / 8.0;
+
+    auto winner_ahead = [&](double red_eval) {
+        return result.winner == PlayerColor::Red ? red_eval > 0 : red_eval < 0;
+    };
+    int streak_start = static_cast<int>(result.moves.size());
+    while (streak_start > 0 && winner_ahead(result.moves[streak_start - 1].red_eval)) --streak_start;
+    if (streak_start < static_cast<int>(result.moves.size())) {
+        result.decisive_move = streak_start + 1;
+        result.moves[streak_start].decisive = true;
+    }
+
+    if (solver) {
+        // Later positions take fewer nodes, and their proofs are in the table when the earlier ones reach them.
+        for (size_t i = history.size(); i-- > 0;) {
+            MoveAnalysis& m = result.moves[i];
+            m.proof = solver->solve(positions[i], m.move.player(), options.solve).proof;
+            if (m.proof == Proof::Unknown) break;
+            result.proven_move = static_cast<int>(i) + 1;
+            bool opponent_wins = i + 1 < history.size()
+                                     ? result.moves[i + 1].proof == Proof::Win
+                                     : final_board.is_game_over() && result.winner != m.move.player();
+            m.lost_win = m.proof == Proof::Win && opponent_wins;
+            result.lost_wins += m.lost_win;
+        }
+    }
+    return result;
+}
+
+std::string format_game(size_t index, const GameAnalysis& analysis, const Options& options) {
+    std::stringstream out;
+    out << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < analysis.moves.size(); ++i) {
+        const MoveAnalysis& m = analysis.moves[i];
+        if (options.jsonl) {
+            out << "{\"type\":\"move\",\"game\":" << index << ",\"move_number\":" << i + 1 << ",\"player\":\""
+                << color_name(m.move.player()) << "\",\"move\":\"" << m.move.encode() << "\",\"best\":" << m.best
+                << ",\"played\":" << m.played << ",\"loss\":" << m.best - m.played
+                << ",\"blunder\":" << (m.blunder ? "true" : "false")
+                << ",\"decisive\":" << (m.decisive ? "true" : "false") << ",\"red_eval\":" << m.red_eval;
+            if (options.solve) {
+                out << ",\"proof\":\"" << PROOF_NAMES[static_cast<int>(m.proof)]
+                    << "\",\"lost_win\":" << (m.lost_win ? "true" : "false");
+            }
+            out << "}\n";
+        } else {
+            out << "move," << index << "," << i + 1 << "," << color_name(m.move.player()) << "," << m.move.encode()
+                << "," << m.best << "," << m.played << "," << m.best - m.played << "," << m.blunder << ","
+                << m.decisive << "," << m.red_eval << ",,,,,,,,,,";
+            if (options.solve) out << "," << PROOF_NAMES[static_cast<int>(m.proof)] << "," << m.lost_win << ",";
+            out << "\n";
+        }
+    }
+    const auto& t = analysis.territory;
+    if (options.jsonl) {
+        out << "{\"type\":\"game\",\"game\":" << index << ",\"winner\":\"" << color_name(analysis.winner)
+            << "\",\"reason\":\"" << REASON_NAMES[analysis.reason] << "\",\"red_total\":" << t.red_total
+            << ",\"blue_total\":" << t.blue_total << ",\"moves\":" << analysis.moves.size()
+            << ",\"decisive_move\":" << analysis.decisive_move << ",\"first_separation\":" << analysis.first_separation
+            << ",\"mean_separation\":" << analysis.mean_separation
+            << ",\"red_blunders\":" << analysis.blunders[static_cast<int>(PlayerColor::Red)]
+            << ",\"blue_blunders\":" << analysis.blunders[static_cast<int>(PlayerColor::Blue)];
+        if (options.solve) out << ",\"proven_move\":" << analysis.proven_move;
+        out << "}\n";
+    } else {
+        out << "game," << index << ",,,,,,,,,," << color_name(analysis.winner) << "," << REASON_NAMES[analysis.reason]
+            << "," << t.red_total << "," << t.blue_total << "," << analysis.moves.size() << ","
+            << analysis.decisive_move << "," << analysis.first_separation << "," << analysis.mean_separation << ","
+            << analysis.blunders[static_cast<int>(PlayerColor::Red)] << ","
+            << analysis.blunders[static_cast<int>(PlayerColor::Blue)];
+        if (options.solve) out << ",,," << analysis.proven_move;
+        out << "\n";
+    }
+    return out.str();
+}
+
+// Writes the output of each game in input order, whichever worker finishes first.
+class OrderedWriter {
+   private:
+    std::mutex mutex_;
+    std::map<size_t, std::string> pending_;
+    size_t next_ = 0;
+    std::ostream& out_;
+
+   public:
+    explicit OrderedWriter(std::ostream& out) : out_(out) {}
+
+    void write(size_t index, std::string text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_[index] = std::move(text);
+        while (!pending_.empty() && pending_.begin()->first == next_) {
+            out_ << pending_.begin()->second;
+            pending_.erase(pending_.begin());
+            ++next_;
+        }
+    }
+};
+
+// Bounded queue of game strings, so that huge archives are streamed rather than loaded.
+class WorkQueue {
+   private:
+    std::mutex mutex_;
+    std::condition_variable not_empty_, not_full_;
+    std::deque<std::pair<size_t, std::string>> items_;
+    size_t capacity_;
+    bool closed_ = false;
+
+   public:
+    explicit WorkQueue(size_t capacity) : capacity_(capacity) {}
+
+    void push(size_t index, std::string item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&] { return items_.size() < capacity_; });
+        items_.emplace_back(index, std::move(item));
+        not_empty_.notify_one();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+    bool pop(std::pair<size_t, std::string>& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        if (items_.empty()) return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+};
+
+struct Summary {
+    std::mutex mutex;
+    int games = 0, failed = 0, blunders = 0, lost_wins = 0;
+    std::vector<int> lengths, first_separations, decisive_moves, proven_moves;
+
+    void add(const GameAnalysis& analysis) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++games;
+        blunders += analysis.blunders[1] + analysis.blunders[2];
+        lengths.push_back(static_cast<int>(analysis.moves.size()));
+        first_separations.push_back(analysis.first_separation);
+        if (analysis.decisive_move > 0) decisive_moves.push_back(analysis.decisive_move);
+        lost_wins += analysis.lost_wins;
+        if (analysis.proven_move > 0) proven_moves.push_back(analysis.proven_move);
+    }
+};
+
+void print_distribution(const std::string& name, std::vector<int> values) {
+    if (values.empty()) return;
+    std::sort(values.begin(), values.end());
+    double mean = 0;
+    for (int v : values) mean += v;
+    mean /= values.size();
+    std::cerr << name << ": mean " << mean << ", median " << values[values.size() / 2] << ", min " << values.front()
+              << ", max " << values.back() << std::endl;
+}
+
+int usage() {
+    std::cerr << "usage: analyze.exe [--engine <name>] [--depth <1|2>] [--threads <n>] [--blunder <loss>]"
+              << " [--format <csv|jsonl>] [--solve <nodes>] [--hash <mb>] [file]\n"
+              << "engines:";
+    for (const auto& name : evaluator_names()) std::cerr << " " << name;
+    std::cerr << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0 && i + 1 >= argc) return usage();
+        if (arg == "--engine") {
+            options.engine = argv[++i];
+        } else if (arg == "--depth") {
+            options.depth = std::stoi(argv[++i]);
+        } else if (arg == "--threads") {
+            options.threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--blunder") {
+            options.blunder = std::stod(argv[++i]);
+        } else if (arg == "--format") {
+            std::string format = argv[++i];
+            if (format != "csv" && format != "jsonl") return usage();
+            options.jsonl = format == "jsonl";
+        } else if (arg == "--solve") {
+            options.solve = std::stoull(argv[++i]);
+        } else if (arg == "--hash") {
+            options.hash = std::max(1, std::stoi(argv[++i]));
+        } else if (arg.rfind("--", 0) == 0 || !options.input.empty()) {
+            return usage();
+        } else {
+            options.input = arg;
+        }
+    }
+    try {
+        make_evaluator(options.engine);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+
+    std::ifstream file;
+    if (!options.input.empty()) {
+        file.open(options.input);
+        if (!file) {
+            std::cerr << "Cannot open " << options.input << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = options.input.empty() ? std::cin : file;
+
+    if (!options.jsonl) {
+        std::cout << "type,game,move_number,player,move,best,played,loss,blunder,decisive,red_eval,"
+                  << "winner,reason,red_total,blue_total,moves,decisive_move,first_separation,mean_separation,"
+                  << "red_blunders,blue_blunders" << (options.solve ? ",proof,lost_win,proven_move" : "") << "\n";
+    }
+
+    OrderedWriter writer(std::cout);
+    WorkQueue queue(options.threads * 4);
+    Summary summary;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&] {
+            std::unique_ptr<Evaluator> evaluator = make_evaluator(options.engine);
+            std::unique_ptr<ProofSolver> solver = options.solve ? std::make_unique<ProofSolver>(options.hash) : nullptr;
+            std::pair<size_t, std::string> item;
+            while (queue.pop(item)) {
+                try {
+                    GameAnalysis analysis = analyze_game(item.second, *evaluator, solver.get(), options);
+                    summary.add(analysis);
+                    writer.write(item.first, format_game(item.first, analysis, options));
+                } catch (const std::exception& e) {
+                    {
+                        std::lock_guard<std::mutex> lock(summary.mutex);
+                        ++summary.failed;
+                    }
+                    std::cerr << "game " << item.first << ": " << e.what() << std::endl;
+                    writer.write(item.first, "");
+                }
+            }
+        });
+    }
+
+    std::string line;
+    size_t index = 0;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        std::string encoded;
+        if (ss >> encoded) queue.push(index++, encoded);
+    }
+    queue.close();
+    for (auto& worker : workers) worker.join();
+
+    std::cerr << summary.games << " games analyzed, " << summary.failed << " failed, " << summary.blunders
+              << " blunders";
+    if (options.solve) std::cerr << ", " << summary.lost_wins << " proven wins thrown away";
+    std::cerr << std::endl;
+    print_distribution("moves per game", summary.lengths);
+    print_distribution("first separation (move)", summary.first_separations);
+    print_distribution("decisive move", summary.decisive_moves);
+    print_distribution("proven from move", summary.proven_moves);
+    return 0;
+}
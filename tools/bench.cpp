@@ -0,0 +1,177 @@
+// Runs a strategy's move decision on a fixed suite of positions and reports the nodes it searched.
+//
+//   bench.exe [options]
+//
+// Options:
+//   --nodes <n>         node budget of every decision (default 20000)
+//   --depth <n>         depth of every decision instead of a node budget
+//   --time <seconds>    clock of every decision, for strategies that follow neither (default 1)
+//   --seed <n>          seed every player is initialized with (default 1)
+//   --games <file>      take the positions from these game strings, one per line, instead of the built-in suite
+//
+// The positions are those after the placements and after every 8 moves of a few recorded games, including the two
+// interesting game states in README.md. Each decision gets a new player, so positions do not affect each other. The
+// total node count is a signature of the search: it changes when the strategy searches differently, and stays the same
+// when the strategy only gets faster. Nodes are the positions the search applied moves to, counted by the library
+// (everything is compiled with -DWALLGO_INSTRUMENT, see tools/compile_bench.sh), plus those the player reports through
+// Player::search_stats. The strategy is linked as red.
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "event_log.h"
+#include "instrumentation.h"
+#include "types.h"
+
+namespace red {
+std::unique_ptr<wallgo::Player> get();
+}
+
+using namespace wallgo;
+
+namespace {
+
+const std::vector<std::string> SUITE = {
+    "53105220132112110612102260235613_3l0qm41j01o4i612454904242l0qm42313j4ri1ci52g11043i14l51l1244qm0295ai02352g11g54"
+    "p04o43g0h659603l5qk03g42603842202943g14o52p0i65360",
+    "05100620342135112212232202230313_b61435p41p45281a851l0qm44m04o4b81pi4ai02g41g03054g13m54m04m44l04m42g0225300p44b"
+    "m03l42m12g52g03l4380ao4ho13o53g1sm42402g4300",
+    "00103420332124115412352232234213_1403543501442o0154pi0985451ik4r213i52k13j5r21jk5381ao5130b65jm03g43219i4bi020529"
+    "1r25s21pi5301",
+    "00100120252124113512362234233313_pm11k51401441k0384ik11j4450324160h44qm0km43p13o5sm0am42g0ao43212841414m4b802m4pk1"
+    "434q611454612i51j0km4301s24sm1j653314m54j14453g1335hm02644j1",
+    "54104220152112112412552234235213_sm1924k81c643j1i442o0424ao13051m1p45j60485121235r20i643g1rm54303p5j41a24k601i5ao"
+    "0165220b852213842m0324980284140rm43g01p41502o4460ri42314o5450",
+};
+
+constexpr size_t MOVES_APART = 8;
+
+struct Options {
+    SearchLimits limits{1, 0, 20000};
+    int seed = 1;
+    std::string games;
+};
+
+struct BenchPosition {
+    std::string game;  // Game string up to the position
+    size_t moves;      // Moves played
+};
+
+// The positions every MOVES_APART moves of the given games, where the game is not over.
+std::vector<BenchPosition> make_positions(const std::vector<std::string>& games) {
+    std::vector<BenchPosition> positions;
+    for (const std::string& encoded : games) {
+        size_t separator = encoded.find('_');
+        size_t total = separator == std::string::npos ? 0 : (encoded.size() - separator - 1) / 3;
+        for (size_t moves = 0; moves < total; moves += MOVES_APART) {
+            positions.push_back({encoded.substr(0, separator + 1 + 3 * moves), moves});
+        }
+    }
+    return positions;
+}
+
+int usage() {
+    std::cerr << "usage: bench.exe [--nodes <n>] [--depth <n>] [--time <seconds>] [--seed <n>] [--games <file>]"
+              << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return usage();
+            if (arg == "--nodes") {
+                options.limits.nodes = std::stoull(argv[++i]);
+            } else if (arg == "--depth") {
+                options.limits.depth = std::stoi(argv[++i]);
+                options.limits.nodes = 0;
+            } else if (arg == "--time") {
+                options.limits.remaining = std::stod(argv[++i]);
+            } else if (arg == "--seed") {
+                options.seed = std::stoi(argv[++i]);
+            } else if (arg == "--games") {
+                options.games = argv[++i];
+            } else {
+                return usage();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+
+    std::vector<std::string> games = SUITE;
+    if (!options.games.empty()) {
+        std::ifstream in(options.games);
+        if (!in) {
+            std::cerr << "Cannot open " << options.games << std::endl;
+            return 1;
+        }
+        games.clear();
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty()) games.push_back(line);
+        }
+    }
+
+    std::vector<BenchPosition> positions = make_positions(games);
+    std::vector<std::shared_ptr<Game>> states;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        try {
+            states.push_back(std::make_shared<Game>(Game::decode(positions[i].game)));
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Position " << i + 1 << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Strategies may print as they think; keep that out of the report and out of the timings.
+    NullBuffer null_buffer;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(&null_buffer);
+    std::ostream out(stdout_buffer);
+    out << std::fixed << std::setw(4) << "pos" << std::setw(7) << "moves" << std::setw(12) << "nodes" << std::setw(10)
+        << "ms" << std::setw(12) << "nps" << "  move\n";
+    uint64_t total_nodes = 0;
+    double total_seconds = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        std::shared_ptr<Game> game = states[i];
+        PlayerColor mover = game->packed_history().size() % 2 == 0 ? PlayerColor::Red : PlayerColor::Blue;
+        std::vector<Move> valid_moves = game->board().get_valid_moves(mover);
+
+        std::unique_ptr<Player> player = red::get();
+        player->init(mover, game, options.seed);
+        player->set_limits(options.limits);
+        SearchStats stats;
+        auto start = std::chrono::steady_clock::now();
+        std::optional<Move> chosen;
+        {
+            WALLGO_RECORD_SEARCH(stats);
+            chosen = player->move(valid_moves);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (const SearchStats* reported = player->search_stats()) stats += *reported;
+
+        total_nodes += stats.nodes;
+        total_seconds += elapsed.count();
+        out << std::setw(4) << i + 1 << std::setw(7) << positions[i].moves << std::setw(12) << stats.nodes
+            << std::setprecision(1) << std::setw(10) << elapsed.count() * 1000 << std::setprecision(0) << std::setw(12)
+            << (elapsed.count() > 0 ? stats.nodes / elapsed.count() : 0) << "  " << chosen->encode() << "\n";
+    }
+    out << "\nPositions  : " << positions.size() << "\nNodes      : " << total_nodes << "\nTime (ms)  : "
+        << std::setprecision(0) << total_seconds * 1000
+        << "\nNodes/sec  : " << (total_seconds > 0 ? total_nodes / total_seconds : 0)
+        << "\nMs/position: " << std::setprecision(2)
+        << (positions.empty() ? 0 : total_seconds * 1000 / positions.size()) << std::endl;
+    std::cout.rdbuf(stdout_buffer);
+    return 0;
+}
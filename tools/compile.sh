@@ -0,0 +1,7 @@
+#!/bin/sh
+# Builds the analysis tools. Run from the repository root, like compile.sh.
+g++ tools/gamedb.cpp lib/game_db.cpp lib/zobrist.cpp lib/types.cpp -std=c++20 -O2 -Wno-unused-result -Ilib -o gamedb.exe
+g++ tools/analyze.cpp lib/evaluation.cpp lib/regions.cpp lib/solver.cpp lib/eval_kernels.cpp lib/nnue.cpp lib/inference.cpp lib/zobrist.cpp lib/types.cpp -std=c++20 -O2 -pthread -Wno-unused-result -Ilib -o analyze.exe
+g++ tools/texel.cpp lib/evaluation.cpp lib/eval_kernels.cpp lib/nnue.cpp lib/inference.cpp lib/zobrist.cpp lib/types.cpp -std=c++20 -O3 -pthread -Wno-unused-result -Ilib -o texel.exe
+g++ tools/tournament.cpp lib/tournament.cpp lib/ratings.cpp lib/engine.cpp lib/game_controller.cpp lib/event_log.cpp lib/types.cpp -std=c++20 -O2 -Wno-unused-result -Ilib -o tournament.exe
+g++ tools/priors.cpp lib/move_priors.cpp lib/cuts.cpp lib/regions.cpp lib/zobrist.cpp lib/types.cpp -std=c++20 -O2 -pthread -Wno-unused-result -Ilib -o priors.exe
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Builds bench.exe to measure the search of the strategy in the given file on fixed positions, e.g.
+#   sh tools/compile_bench.sh strategies/old-impl.cpp
+# Everything is compiled with -DWALLGO_INSTRUMENT so that the library counts nodes. Run from the repository root, like
+# compile.sh.
+if [ $# -ne 1 ]; then
+    echo "usage: sh tools/compile_bench.sh <strategy.cpp>" >&2
+    exit 2
+fi
+g++ "$1" -std=c++20 -O2 -Wno-unused-result -DWALLGO_INSTRUMENT -DRED -c -o strategies/bench.o -Ilib
+g++ tools/bench.cpp strategies/bench.o lib/types.cpp -std=c++20 -O2 -Wno-unused-result -DWALLGO_INSTRUMENT -Ilib -o bench.exe
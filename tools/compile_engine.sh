@@ -0,0 +1,10 @@
+#!/bin/sh
+# Builds an engine process for the strategy in the given file, e.g.
+#   sh tools/compile_engine.sh strategies/impl.cpp impl-engine.exe
+# which exec.exe can then play with --red-engine ./impl-engine.exe. Run from the repository root, like compile.sh.
+if [ $# -lt 1 ] || [ $# -gt 2 ]; then
+    echo "usage: sh tools/compile_engine.sh <strategy.cpp> [output]" >&2
+    exit 2
+fi
+g++ "$1" -std=c++20 -O2 -Wno-unused-result -DRED -c -o strategies/engine.o -Ilib
+g++ tools/engine.cpp strategies/engine.o lib/engine.cpp lib/types.cpp -std=c++20 -O2 -Wno-unused-result -Ilib -o "${2:-engine.exe}"
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Builds match.exe to test the strategy in the first file ("new") against the one in the second ("base"), e.g.
+#   sh tools/compile_match.sh strategies/impl.cpp strategies/random.cpp
+# Run from the repository root, like compile.sh.
+if [ $# -ne 2 ]; then
+    echo "usage: sh tools/compile_match.sh <new.cpp> <base.cpp>" >&2
+    exit 2
+fi
+g++ "$1" -std=c++20 -O2 -Wno-unused-result -DRED -c -o strategies/new.o -Ilib
+g++ "$2" -std=c++20 -O2 -Wno-unused-result -DBLUE -c -o strategies/base.o -Ilib
+g++ tools/match.cpp strategies/new.o strategies/base.o lib/game_controller.cpp lib/event_log.cpp lib/latency_histogram.cpp lib/sprt.cpp lib/types.cpp -std=c++20 -O2 -pthread -Wno-unused-result -Ilib -o match.exe
@@ -0,0 +1,10 @@
+#!/bin/sh
+# Builds tune.exe to tune the parameters registered by the strategy in the given file, e.g.
+#   sh tools/compile_tune.sh strategies/trainers/ethen-impl.cpp
+# Run from the repository root, like compile.sh.
+if [ $# -ne 1 ]; then
+    echo "usage: sh tools/compile_tune.sh <strategy.cpp>" >&2
+    exit 2
+fi
+g++ "$1" -std=c++20 -O2 -Wno-unused-result -DRED -c -o strategies/tuned.o -Ilib
+g++ tools/tune.cpp strategies/tuned.o lib/game_controller.cpp lib/event_log.cpp lib/types.cpp -std=c++20 -O2 -pthread -Wno-unused-result -Ilib -o tune.exe
@@ -0,0 +1,26 @@
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "engine.h"
+
+namespace red {
+std::unique_ptr<wallgo::Player> get();
+}
+
+// Usage: engine.exe
+// Serves the strategy linked in as red::get over the protocol in engine.h on stdin and stdout. Whatever the strategy
+// itself prints to stdout goes to stderr, so that it cannot break the protocol.
+int main() {
+    int protocol_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    std::ofstream protocol("/dev/fd/" + std::to_string(protocol_fd));
+    if (!protocol) {
+        std::cerr << "Cannot open the protocol stream" << std::endl;
+        return 1;
+    }
+    close(protocol_fd);
+    return wallgo::serve_engine(std::cin, protocol, red::get);
+}
@@ -0,0 +1,108 @@
+// Builds and queries binary game databases.
+//
+//   gamedb.exe build <db> [file]        reads one game string per line (stdin if no file) into a new database
+//   gamedb.exe stats <db>               prints the number of games per winner and reason
+//   gamedb.exe outcome <db> <red|blue> <reason>
+//                                       prints the games won by a player for a reason, e.g. "blue largest"
+//   gamedb.exe position <db> <game>     prints the games that reached the final position of a game string
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "game_db.h"
+#include "types.h"
+
+using namespace wallgo;
+
+namespace {
+
+const char* REASON_NAMES[] = {"total", "largest", "last", "tle", "illegal"};
+
+int usage() {
+    std::cerr << "usage: gamedb.exe build <db> [file]\n"
+              << "       gamedb.exe stats <db>\n"
+              << "       gamedb.exe outcome <db> <red|blue> <total|largest|last|tle|illegal>\n"
+              << "       gamedb.exe position <db> <game string>\n";
+    return 2;
+}
+
+int build(const std::string& path, std::istream& in) {
+    GameDatabaseBuilder builder;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        std::stringstream ss(line);
+        std::string encoded;
+        if (!(ss >> encoded)) continue;
+        try {
+            builder.add(encoded);
+        } catch (const std::exception& e) {
+            std::cerr << "line " << line_number << ": " << e.what() << std::endl;
+        }
+    }
+    builder.write(path);
+    std::cout << "Wrote " << builder.size() << " games to " << path << std::endl;
+    return 0;
+}
+
+void print_game(const GameDatabase& db, uint32_t id) {
+    const GameRecord& rec = db.record(id);
+    std::cout << id << "\t" << (rec.winner == static_cast<int>(PlayerColor::Red) ? "red" : "blue") << "\t"
+              << REASON_NAMES[rec.reason] << "\t" << int(rec.red_total) << "-" << int(rec.blue_total) << "\t"
+              << db.encode(id) << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage();
+    std::string command = argv[1];
+
+    try {
+        if (command == "build") {
+            if (argc == 3) return build(argv[2], std::cin);
+            std::ifstream in(argv[3]);
+            if (!in) {
+                std::cerr << "Cannot open " << argv[3] << std::endl;
+                return 1;
+            }
+            return build(argv[2], in);
+        }
+
+        GameDatabase db(argv[2]);
+        if (command == "stats") {
+            std::cout << db.size() << " games\n";
+            for (PlayerColor winner : {PlayerColor::Red, PlayerColor::Blue}) {
+                for (int reason = 0; reason < 5; ++reason) {
+                    std::cout << (winner == PlayerColor::Red ? "red" : "blue") << "\t" << REASON_NAMES[reason] << "\t"
+                              << db.games_by_outcome(winner, static_cast<Reason>(reason)).size() << "\n";
+                }
+            }
+        } else if (command == "outcome" && argc == 5) {
+            std::string color = argv[3];
+            if (color != "red" && color != "blue") return usage();
+            int reason = 0;
+            while (reason < 5 && REASON_NAMES[reason] != std::string(argv[4])) ++reason;
+            if (reason == 5) return usage();
+            PlayerColor winner = color == "red" ? PlayerColor::Red : PlayerColor::Blue;
+            for (uint32_t id : db.games_by_outcome(winner, static_cast<Reason>(reason))) {
+                print_game(db, id);
+            }
+        } else if (command == "position" && argc == 4) {
+            uint64_t key = GameDatabase::position_key(Game::decode(argv[3]));
+            for (const PositionEntry& entry : db.find_position(key)) {
+                std::cout << "ply " << entry.ply << "\t";
+                print_game(db, entry.game);
+            }
+        } else {
+            return usage();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,208 @@
+// Plays the strategy linked as red against the strategy linked as blue until an SPRT decides between them.
+//
+//   match.exe [options]
+//
+// Options:
+//   --elo0 <elo>        Elo difference under H0 (default 0)
+//   --elo1 <elo>        Elo difference under H1 (default 5)
+//   --alpha <p>         chance of accepting H1 when H0 holds (default 0.05)
+//   --beta <p>          chance of accepting H0 when H1 holds (default 0.05)
+//   --max-pairs <n>     stop undecided after this many game pairs (default 20000)
+//   --threads <n>       number of games played at once (default: all cores)
+//   --tc <spec>         time control, as in wallgo::TimeControl::parse
+//   --seed <n>          seed of the first pair; pair i uses seed + i (default: from the clock)
+//
+// Games are played in pairs with the same seed, each strategy playing Red once. The strategies are built from any
+// two strategy files with tools/compile_match.sh; "new" is the one linked as red, "base" the one linked as blue.
+// Whatever the strategies print is discarded. Progress goes to stderr and the result to stdout.
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_log.h"
+#include "game_controller.h"
+#include "latency_histogram.h"
+#include "sprt.h"
+#include "types.h"
+
+namespace red {
+std::unique_ptr<wallgo::Player> get();
+}
+
+namespace blue {
+std::unique_ptr<wallgo::Player> get();
+}
+
+using namespace wallgo;
+
+namespace {
+
+struct Options {
+    double elo0 = 0, elo1 = 5;
+    double alpha = 0.05, beta = 0.05;
+    uint64_t max_pairs = 20000;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    TimeControl time_control;
+    int seed = std::chrono::steady_clock::now().time_since_epoch().count() % (int)(1e9 + 7);
+};
+
+// Shared state of the match, guarded by mutex.
+struct Match {
+    std::mutex mutex;
+    Sprt sprt;
+    LatencyHistogram latency[2];  // new, base
+    uint64_t tle[2] = {}, illegal[2] = {};
+    uint64_t red_wins = 0;
+    std::atomic<uint64_t> next_pair{0};
+    std::atomic<bool> done{false};
+
+    explicit Match(const Options& options) : sprt(options.elo0, options.elo1, options.alpha, options.beta) {}
+};
+
+// Plays one game and returns whether the new strategy won.
+bool play_game(Match& match, int seed, bool new_is_red, const TimeControl& time_control) {
+    std::unique_ptr<Player> new_player = red::get(), base_player = blue::get();
+    std::unique_ptr<Player>& p1 = new_is_red ? new_player : base_player;
+    std::unique_ptr<Player>& p2 = new_is_red ? base_player : new_player;
+    GameOutcome outcome;
+    try {
+        GameController controller(seed, std::move(p1), std::move(p2), std::make_unique<NullSink>(), nullptr,
+                                  time_control);
+        outcome = controller.run();
+    } catch (const InitTimeout& e) {
+        outcome = e.outcome;
+    }
+
+    PlayerColor new_color = new_is_red ? PlayerColor::Red : PlayerColor::Blue;
+    bool new_won = outcome.winner == new_color;
+    int loser = new_won ? 1 : 0;  // Index into the per-strategy counters
+
+    std::lock_guard<std::mutex> lock(match.mutex);
+    match.latency[0].add(outcome.timing[static_cast<int>(new_color)]);
+    match.latency[1].add(outcome.timing[3 - static_cast<int>(new_color)]);
+    if (outcome.reason == OPPONENT_TLE) ++match.tle[loser];
+    if (outcome.reason == OPPONENT_ILLEGAL_MOVE) ++match.illegal[loser];
+    if (outcome.winner == PlayerColor::Red) ++match.red_wins;
+    return new_won;
+}
+
+void print_status(std::ostream& out, const Match& match) {
+    const Sprt& sprt = match.sprt;
+    Sprt::Estimate elo = sprt.elo();
+    out << "pairs " << sprt.pairs() << ", games " << 2 * sprt.pairs() << ", new " << sprt.wins() << "-"
+        << 2 * sprt.pairs() - sprt.wins() << " base, pair outcomes " << sprt.pair_counts()[0] << "/"
+        << sprt.pair_counts()[1] << "/" << sprt.pair_counts()[2] << ", elo " << elo.elo << " +- " << elo.error
+        << ", llr " << sprt.llr() << " [" << sprt.lower_bound() << ", " << sprt.upper_bound() << "]";
+}
+
+int usage() {
+    std::cerr << "usage: match.exe [--elo0 <elo>] [--elo1 <elo>] [--alpha <p>] [--beta <p>] [--max-pairs <n>]"
+              << " [--threads <n>] [--tc <spec>] [--seed <n>]" << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) return usage();
+            if (arg == "--elo0") {
+                options.elo0 = std::stod(argv[++i]);
+            } else if (arg == "--elo1") {
+                options.elo1 = std::stod(argv[++i]);
+            } else if (arg == "--alpha") {
+                options.alpha = std::stod(argv[++i]);
+            } else if (arg == "--beta") {
+                options.beta = std::stod(argv[++i]);
+            } else if (arg == "--max-pairs") {
+                options.max_pairs = std::stoull(argv[++i]);
+            } else if (arg == "--threads") {
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--tc") {
+                options.time_control = TimeControl::parse(argv[++i]);
+            } else if (arg == "--seed") {
+                options.seed = std::stoi(argv[++i]);
+            } else {
+                return usage();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+
+    std::unique_ptr<Match> match;
+    try {
+        match = std::make_unique<Match>(options);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+    std::cerr << "seed " << options.seed << ", H0 elo " << options.elo0 << ", H1 elo " << options.elo1 << std::endl;
+
+    NullBuffer null_buffer;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(&null_buffer);
+
+    std::string error;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&] {
+            while (!match->done) {
+                uint64_t pair = match->next_pair++;
+                if (pair >= options.max_pairs) break;
+                int seed = static_cast<int>((options.seed + pair) % (int)(1e9 + 7));
+                int wins;
+                try {
+                    wins = play_game(*match, seed, true, options.time_control) +
+                           play_game(*match, seed, false, options.time_control);
+                } catch (const std::exception& e) {
+                    // Not a loss of either side but a failure of the match itself, e.g. a strategy that throws.
+                    std::lock_guard<std::mutex> lock(match->mutex);
+                    error = "Pair with seed " + std::to_string(seed) + ": " + e.what();
+                    match->done = true;
+                    break;
+                }
+
+                std::lock_guard<std::mutex> lock(match->mutex);
+                match->sprt.add_pair(wins);
+                if (match->sprt.pairs() % 50 == 0) {
+                    print_status(std::cerr, *match);
+                    std::cerr << std::endl;
+                }
+                if (match->sprt.status() != Sprt::Status::Continue) match->done = true;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::cout.rdbuf(stdout_buffer);
+
+    if (!error.empty()) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    Sprt::Status status = match->sprt.status();
+    print_status(std::cout, *match);
+    std::cout << "\nresult: "
+              << (status == Sprt::Status::AcceptH1   ? "H1 accepted, new is stronger"
+                  : status == Sprt::Status::AcceptH0 ? "H0 accepted, new is not stronger"
+                                                     : "inconclusive")
+              << "\nred won " << match->red_wins << " of " << 2 * match->sprt.pairs() << " games\n";
+    const char* names[] = {"new", "base"};
+    for (int i = 0; i < 2; ++i) {
+        std::cout << names[i] << ": lost " << match->tle[i] << " on time, " << match->illegal[i]
+                  << " by illegal moves; decision time " << match->latency[i].summary() << "\n";
+    }
+    return 0;
+}
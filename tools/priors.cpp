@@ -0,0 +1,243 @@
+// Mines recorded games for how often moves with each combination of features are played, and writes move priors.
+//
+//   priors.exe [options] [file...]    reads one game string per line (stdin if no file)
+//
+// Options:
+//   --winner            count only the moves of each game's winner
+//   --smoothing <n>     virtual moves at the average rate added to every feature combination (default 20)
+//   --threads <n>       number of worker threads (default: all cores)
+//   --out <file>        where the priors are written (default priors.table)
+//
+// In every position after the placements, each legal move of the player to act counts as available for its
+// combination of features (see MoveFeatures in lib/move_priors.h) and the move actually played counts as played. A
+// combination's prior is the natural log of its smoothed played/available rate over the rate of all moves. Every
+// tenth game is held out: the report compares where the played move ranks in generator order and in prior order,
+// and the best and worst combinations, on stderr.
+//
+// Read the table with read_move_priors and pass it to ordered_moves or sort_by_prior to search likely moves first.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "move_priors.h"
+#include "types.h"
+
+using namespace wallgo;
+
+namespace {
+
+struct Options {
+    bool winner_only = false;
+    double smoothing = 20;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string out = "priors.table";
+    std::vector<std::string> inputs;
+};
+
+struct Counts {
+    std::array<uint64_t, MoveFeatures::COUNT> available = {}, played = {};
+    int failed = 0;
+};
+
+// Where the played move ranks among the legal moves, 1 for first.
+struct Ranks {
+    uint64_t positions = 0, sum = 0, first = 0, top5 = 0;
+    double fraction = 0;  // Sum of rank / moves
+
+    void add(size_t rank, size_t moves) {
+        ++positions;
+        sum += rank;
+        first += rank == 1;
+        top5 += rank <= 5;
+        fraction += static_cast<double>(rank) / moves;
+    }
+
+    void print(const std::string& name) const {
+        if (!positions) return;
+        std::cerr << std::fixed << std::setprecision(2) << std::setw(10) << name << ": mean rank " << std::setw(6)
+                  << static_cast<double>(sum) / positions << ", first " << std::setw(5) << 100.0 * first / positions
+                  << "%, top 5 " << std::setw(5) << 100.0 * top5 / positions << "%, mean depth in list "
+                  << std::setw(5) << 100 * fraction / positions << "%" << std::endl;
+    }
+};
+
+// The winner of a game. As in analyze.exe, a string that ends before the game does is a loss for the player to act.
+PlayerColor winner_of(const Game& game) {
+    Board board = game.board();
+    PlayerColor to_act = game.packed_history().size() % 2 == 0 ? PlayerColor::Red : PlayerColor::Blue;
+    if (game.placements().size() < 8 || !board.is_game_over()) return opponent_of(to_act);
+    return decide_winner(board.get_territory(), opponent_of(to_act)).first;
+}
+
+// Replays a game and calls visit(board, played, moves, features) before every move that counts.
+template <typename Visit>
+void replay(const std::string& encoded, bool winner_only, Visit visit) {
+    Game game = Game::decode(encoded);
+    PlayerColor winner = winner_of(game);
+    Game position;
+    for (const Piece& piece : game.placements()) {
+        position.place_piece(piece.pos, piece.owner, piece.id);
+    }
+    for (PackedMove played : game.packed_history()) {
+        if (!winner_only || played.player() == winner) {
+            Board board = position.board();
+            std::vector<PackedMove> moves = board.get_packed_moves(played.player());
+            visit(board, played, moves, MoveFeatures(board, played.player()));
+        }
+        position.apply_move(played.unpack());
+    }
+}
+
+MovePriors fit(const Counts& counts, double smoothing) {
+    uint64_t available = std::accumulate(counts.available.begin(), counts.available.end(), uint64_t{0});
+    uint64_t played = std::accumulate(counts.played.begin(), counts.played.end(), uint64_t{0});
+    double average = available ? static_cast<double>(played) / available : 0;
+    MovePriors priors;
+    for (int i = 0; i < MoveFeatures::COUNT; ++i) {
+        double rate = (counts.played[i] + smoothing * average) / (counts.available[i] + smoothing);
+        priors.prior[i] = average > 0 ? static_cast<float>(std::log(rate / average)) : 0;
+    }
+    return priors;
+}
+
+int usage() {
+    std::cerr << "usage: priors.exe [--winner] [--smoothing <n>] [--threads <n>] [--out <file>] [file...]"
+              << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--winner") {
+                options.winner_only = true;
+                continue;
+            }
+            if (arg.rfind("--", 0) == 0 && i + 1 >= argc) return usage();
+            if (arg == "--smoothing") {
+                options.smoothing = std::stod(argv[++i]);
+            } else if (arg == "--threads") {
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--out") {
+                options.out = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                return usage();
+            } else {
+                options.inputs.push_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+
+    std::vector<std::string> games;
+    auto read = [&](std::istream& in) {
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty()) games.push_back(line);
+        }
+    };
+    if (options.inputs.empty()) read(std::cin);
+    for (const std::string& input : options.inputs) {
+        std::ifstream in(input);
+        if (!in) {
+            std::cerr << "Cannot open " << input << std::endl;
+            return 1;
+        }
+        read(in);
+    }
+
+    // Count the training games on all threads.
+    std::vector<Counts> parts(options.threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&, t] {
+            Counts& counts = parts[t];
+            for (size_t g = t; g < games.size(); g += options.threads) {
+                if (g % 10 == 9) continue;
+                try {
+                    replay(games[g], options.winner_only,
+                           [&](const Board&, PackedMove played, const std::vector<PackedMove>& moves,
+                               const MoveFeatures& features) {
+                               for (PackedMove move : moves) ++counts.available[features.index(move)];
+                               ++counts.played[features.index(played)];
+                           });
+                } catch (const std::exception& e) {
+                    ++counts.failed;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    Counts counts;
+    for (const Counts& part : parts) {
+        for (int i = 0; i < MoveFeatures::COUNT; ++i) {
+            counts.available[i] += part.available[i];
+            counts.played[i] += part.played[i];
+        }
+        counts.failed += part.failed;
+    }
+    MovePriors priors = fit(counts, options.smoothing);
+    try {
+        write_move_priors(options.out, priors);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // Rank the played moves of the held-out games.
+    Ranks generator, sorted;
+    for (size_t g = 9; g < games.size(); g += 10) {
+        try {
+            replay(games[g], options.winner_only,
+                   [&](const Board&, PackedMove played, const std::vector<PackedMove>& moves,
+                       const MoveFeatures& features) {
+                       size_t at = std::find(moves.begin(), moves.end(), played) - moves.begin();
+                       float prior = priors.prior[features.index(played)];
+                       size_t rank = 1;
+                       for (size_t i = 0; i < moves.size(); ++i) {
+                           float other = priors.prior[features.index(moves[i])];
+                           rank += other > prior || (other == prior && i < at);
+                       }
+                       generator.add(at + 1, moves.size());
+                       sorted.add(rank, moves.size());
+                   });
+        } catch (const std::exception& e) {
+            ++counts.failed;
+        }
+    }
+
+    uint64_t positions = std::accumulate(counts.played.begin(), counts.played.end(), uint64_t{0});
+    std::cerr << games.size() << " games, " << counts.failed << " could not be replayed; " << positions
+              << " training positions, priors written to " << options.out << std::endl;
+    generator.print("generator");
+    sorted.print("priors");
+
+    std::vector<int> order(MoveFeatures::COUNT);
+    std::iota(order.begin(), order.end(), 0);
+    std::erase_if(order, [&](int i) { return counts.available[i] < options.smoothing * 10; });
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return priors.prior[a] > priors.prior[b]; });
+    auto show = [&](int i) {
+        std::cerr << std::setprecision(2) << std::setw(7) << priors.prior[i] << "  " << std::setw(9)
+                  << counts.played[i] << " / " << std::setw(10) << counts.available[i] << "  "
+                  << MoveFeatures::describe(i) << std::endl;
+    };
+    std::cerr << "most likely (prior, played / available):" << std::endl;
+    for (size_t i = 0; i < std::min<size_t>(10, order.size()); ++i) show(order[i]);
+    std::cerr << "least likely:" << std::endl;
+    for (size_t i = order.size() - std::min<size_t>(5, order.size()); i < order.size(); ++i) show(order[i]);
+    return 0;
+}
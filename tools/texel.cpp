@@ -0,0 +1,300 @@
+// Fits a pair table evaluation to the outcomes of recorded games.
+//
+//   texel.exe [options] [file...]    reads one game string per line (stdin if no file)
+//
+// Options:
+//   --target <win|margin>  fit the probability that Red wins (default), or the final territory difference
+//   --epochs <n>           full passes of gradient descent (default 1000)
+//   --rate <r>             Adam learning rate (default 0.01; margin fits converge faster with about 0.1)
+//   --threads <n>          number of worker threads (default: all cores)
+//   --out <file>           where the fitted table is written (default pairs.table)
+//
+// Every position after a move of a finished game is a sample. Its features count, for each pair of distances (d, e)
+// with d < e, the cells that Red reaches in d steps and Blue in e, minus the cells where it is the other way round;
+// distances are bucketed as in kernels::PairTable. The features are computed once into one contiguous matrix of
+// bytes, and the weights are fitted by full-batch Adam with the gradient summed over rows by all threads. Every tenth
+// game is held out to report the validation error.
+//
+// The weights form an antisymmetric pair table, so the result can be used directly with --engine table:<file> or
+// make_evaluator("table:<file>"). For --target win the scores are logits; for margin they are cells.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eval_kernels.h"
+#include "evaluation.h"
+#include "types.h"
+
+using namespace wallgo;
+
+namespace {
+
+constexpr int BUCKETS = 16;
+constexpr int FEATURES = BUCKETS * (BUCKETS - 1) / 2;
+static_assert(FEATURES % 8 == 0);
+
+struct Options {
+    bool margin = false;
+    int epochs = 1000;
+    double rate = 0.01;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string out = "pairs.table";
+    std::vector<std::string> inputs;
+};
+
+// Samples as rows of FEATURES signed counts, stored back to back.
+struct Samples {
+    std::vector<int8_t> features;
+    std::vector<float> labels;
+
+    size_t size() const { return labels.size(); }
+    const int8_t* row(size_t i) const { return features.data() + i * FEATURES; }
+};
+
+int bucket(int distance) { return distance == UNREACHABLE ? 15 : std::min(distance, 14); }
+
+// Index of the pair (d, e) with d < e among all such pairs.
+int feature_index(int d, int e) { return d * BUCKETS - d * (d + 1) / 2 + (e - d - 1); }
+
+void add_sample(const Board& board, float label, Samples& samples) {
+    DistanceField red = distance_field(board, PlayerColor::Red);
+    DistanceField blue = distance_field(board, PlayerColor::Blue);
+    std::array<int8_t, FEATURES> row = {};
+    for (int cell = 0; cell < 49; ++cell) {
+        int d = bucket(red[cell]), e = bucket(blue[cell]);
+        if (d < e) ++row[feature_index(d, e)];
+        if (d > e) --row[feature_index(e, d)];
+    }
+    samples.features.insert(samples.features.end(), row.begin(), row.end());
+    samples.labels.push_back(label);
+}
+
+// Adds the positions of a finished game. Returns false if the game did not finish.
+bool add_game(const std::string& encoded, bool margin, Samples& samples) {
+    Game recorded = Game::decode(encoded);
+    if (!recorded.board().is_game_over()) return false;
+    auto territory = recorded.board().get_territory();
+    std::vector<Move> history = recorded.history();
+    PlayerColor last_mover = history.empty() ? PlayerColor::Blue : history.back().player();
+    float label = margin ? static_cast<float>(territory.red_total - territory.blue_total)
+                         : decide_winner(territory, last_mover).first == PlayerColor::Red;
+
+    Game game;
+    for (const Piece& piece : recorded.placements()) {
+        game.place_piece(piece.pos, piece.owner, piece.id);
+    }
+    for (const Move& move : history) {
+        game.apply_move(move);
+        add_sample(game.board(), label, samples);
+    }
+    return true;
+}
+
+// Computes features of all games with all threads. Games are split into training and validation samples.
+void load(const std::vector<std::string>& games, const Options& options, Samples& train, Samples& validation) {
+    std::vector<Samples> parts(2 * options.threads);
+    std::vector<int> unfinished(options.threads), failed(options.threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t g = t; g < games.size(); g += options.threads) {
+                try {
+                    if (!add_game(games[g], options.margin, parts[2 * t + (g % 10 == 9)])) ++unfinished[t];
+                } catch (const std::exception& e) {
+                    ++failed[t];
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (int t = 0; t < options.threads; ++t) {
+        for (int held_out = 0; held_out < 2; ++held_out) {
+            Samples& part = parts[2 * t + held_out];
+            Samples& target = held_out ? validation : train;
+            target.features.insert(target.features.end(), part.features.begin(), part.features.end());
+            target.labels.insert(target.labels.end(), part.labels.begin(), part.labels.end());
+            part = Samples();
+        }
+    }
+    int total_unfinished = 0, total_failed = 0;
+    for (int t = 0; t < options.threads; ++t) {
+        total_unfinished += unfinished[t];
+        total_failed += failed[t];
+    }
+    std::cerr << games.size() << " games, " << total_unfinished << " unfinished, " << total_failed
+              << " could not be replayed; " << train.size() << " training and " << validation.size()
+              << " validation positions" << std::endl;
+}
+
+double sigmoid(double x) { return 1 / (1 + std::exp(-x)); }
+
+// Mean squared error over samples and, if gradient is given, its gradient with respect to the weights.
+double error(const Samples& samples, const std::vector<double>& weights, bool margin, int threads,
+             std::vector<double>* gradient) {
+    if (samples.size() == 0) return 0;
+    std::vector<double> losses(threads);
+    std::vector<std::vector<double>> gradients(threads, std::vector<double>(gradient ? FEATURES : 0));
+    std::vector<std::thread> workers;
+    size_t chunk = (samples.size() + threads - 1) / threads;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            size_t begin = t * chunk, end = std::min(samples.size(), begin + chunk);
+            // Rows are processed in float so that the loops vectorize; each block of rows is summed into double.
+            std::array<float, FEATURES> w, block = {};
+            std::copy(weights.begin(), weights.end(), w.begin());
+            std::vector<double>& partial = gradients[t];
+            double loss = 0;
+            for (size_t i = begin; i < end; ++i) {
+                const int8_t* row = samples.row(i);
+                std::array<float, 8> lanes = {};
+                for (int j = 0; j < FEATURES; j += 8) {
+                    for (int k = 0; k < 8; ++k) {
+                        lanes[k] += w[j + k] * row[j + k];
+                    }
+                }
+                float eval = 0;
+                for (float lane : lanes) {
+                    eval += lane;
+                }
+                double prediction = margin ? eval : sigmoid(eval);
+                double diff = prediction - samples.labels[i];
+                loss += diff * diff;
+                if (gradient) {
+                    float slope = 2 * diff * (margin ? 1 : prediction * (1 - prediction));
+                    for (int j = 0; j < FEATURES; ++j) {
+                        block[j] += slope * row[j];
+                    }
+                    if ((i - begin) % 1024 == 1023 || i + 1 == end) {
+                        for (int j = 0; j < FEATURES; ++j) {
+                            partial[j] += block[j];
+                        }
+                        block.fill(0);
+                    }
+                }
+            }
+            losses[t] = loss;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double loss = 0;
+    if (gradient) gradient->assign(FEATURES, 0);
+    for (int t = 0; t < threads; ++t) {
+        loss += losses[t];
+        if (gradient) {
+            for (int j = 0; j < FEATURES; ++j) {
+                (*gradient)[j] += gradients[t][j] / samples.size();
+            }
+        }
+    }
+    return loss / samples.size();
+}
+
+kernels::PairTable to_table(const std::vector<double>& weights) {
+    kernels::PairTable table = {};
+    for (int d = 0; d < BUCKETS; ++d) {
+        for (int e = d + 1; e < BUCKETS; ++e) {
+            table.at(d, e) = static_cast<float>(weights[feature_index(d, e)]);
+            table.at(e, d) = -table.at(d, e);
+        }
+    }
+    return table;
+}
+
+int usage() {
+    std::cerr << "usage: texel.exe [--target <win|margin>] [--epochs <n>] [--rate <r>] [--threads <n>] [--out <file>]"
+              << " [file...]" << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) == 0 && i + 1 >= argc) return usage();
+            if (arg == "--target") {
+                std::string target = argv[++i];
+                if (target != "win" && target != "margin") return usage();
+                options.margin = target == "margin";
+            } else if (arg == "--epochs") {
+                options.epochs = std::stoi(argv[++i]);
+            } else if (arg == "--rate") {
+                options.rate = std::stod(argv[++i]);
+            } else if (arg == "--threads") {
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--out") {
+                options.out = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                return usage();
+            } else {
+                options.inputs.push_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+
+    std::vector<std::string> games;
+    auto read_games = [&](std::istream& in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) games.push_back(line);
+        }
+    };
+    if (options.inputs.empty()) read_games(std::cin);
+    for (const auto& input : options.inputs) {
+        std::ifstream file(input);
+        if (!file) {
+            std::cerr << "Cannot open " << input << std::endl;
+            return 1;
+        }
+        read_games(file);
+    }
+
+    Samples train, validation;
+    load(games, options, train, validation);
+    if (train.size() == 0) {
+        std::cerr << "No positions to fit" << std::endl;
+        return 1;
+    }
+
+    // Adam
+    constexpr double BETA1 = 0.9, BETA2 = 0.999, EPSILON = 1e-8;
+    std::vector<double> weights(FEATURES), gradient, m(FEATURES), v(FEATURES);
+    for (int epoch = 1; epoch <= options.epochs; ++epoch) {
+        double loss = error(train, weights, options.margin, options.threads, &gradient);
+        for (int j = 0; j < FEATURES; ++j) {
+            m[j] = BETA1 * m[j] + (1 - BETA1) * gradient[j];
+            v[j] = BETA2 * v[j] + (1 - BETA2) * gradient[j] * gradient[j];
+            double m_hat = m[j] / (1 - std::pow(BETA1, epoch)), v_hat = v[j] / (1 - std::pow(BETA2, epoch));
+            weights[j] -= options.rate * m_hat / (std::sqrt(v_hat) + EPSILON);
+        }
+        if (epoch % 100 == 0 || epoch == options.epochs) {
+            std::cerr << "epoch " << epoch << ": training error " << loss << ", validation error "
+                      << error(validation, weights, options.margin, options.threads, nullptr) << std::endl;
+        }
+    }
+
+    try {
+        write_pair_table(options.out, to_table(weights));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Wrote " << options.out << std::endl;
+    return 0;
+}
@@ -0,0 +1,416 @@
+// Plays a round robin or gauntlet between engines on several worker processes and rates them.
+//
+//   tournament.exe --engine <name>=<command> --engine <name>=<command>... [options]
+//
+// Options:
+//   --engine <name>=<command>  a participant, run as an engine process (see lib/engine.h, tools/compile_engine.sh)
+//   --gauntlet          play the first engine against each other one instead of every pairing
+//   --rounds <n>        game pairs per pairing (default 1)
+//   --workers <n>       worker processes, each playing one game pair at a time (default: all cores)
+//   --tc <spec>         time control, as in wallgo::TimeControl::parse
+//   --seed <n>          seed of the first pair; pair i uses seed + i (default: from the results file, or the clock)
+//   --results <file>    where results are recorded (default tournament.results)
+//   --every <n>         print the ratings to stderr every n pairs (default 10)
+//   --pair-timeout <s>  seconds a worker may spend on one pair before it is killed and restarted (default 300)
+//
+// Every pairing is played as pairs of games with the same seed and colors swapped. The coordinator hands pairs to
+// worker processes over pipes; each worker keeps one engine process per participant for all its games and restarts
+// an engine that failed. Results are appended to the results file as they come in and synced to disk, so the
+// tournament can be killed at any time: run the same command again and it continues with the pairs that are not in
+// the file yet. The ratings (see lib/ratings.h) are updated after every pair and printed to stdout at the end.
+//
+// An engine that overruns its clock while initializing loses that game on time. A pair whose worker dies or times out
+// is played again once on a fresh worker; if that fails too, or the worker cannot play it at all, the pair is logged
+// and skipped, so a misbehaving engine never stops the tournament. Skipped pairs are retried on the next run.
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine.h"
+#include "event_log.h"
+#include "game_controller.h"
+#include "ratings.h"
+#include "tournament.h"
+#include "types.h"
+
+using namespace wallgo;
+
+namespace {
+
+struct Options {
+    std::vector<std::string> names, commands;
+    bool gauntlet = false;
+    int rounds = 1;
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    std::string time_control;
+    std::optional<int> seed;
+    std::string results = "tournament.results";
+    int every = 10;
+    double pair_timeout = 300;
+};
+
+// A worker process and the unit it is playing, if any.
+struct Worker {
+    pid_t pid = -1;
+    int to = -1, from = -1;
+    std::string buffer;
+    std::optional<WorkUnit> unit;
+    std::chrono::steady_clock::time_point deadline;  // When the unit must be done
+};
+
+// Attempts at a pair before it is skipped, counting those whose worker died or timed out.
+constexpr int MAX_ATTEMPTS = 2;
+
+std::string header(const Options& options, int seed) {
+    std::string line = "# wallgo tournament seed=" + std::to_string(seed) +
+                       " schedule=" + (options.gauntlet ? "gauntlet" : "roundrobin") +
+                       " rounds=" + std::to_string(options.rounds) + " tc=" + options.time_control + " players=";
+    for (size_t i = 0; i < options.names.size(); ++i) {
+        line += (i ? "," : "") + options.names[i];
+    }
+    return line;
+}
+
+// The seed in the header of an existing results file, if any.
+std::optional<int> recorded_seed(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) return std::nullopt;
+    size_t at = line.find(" seed=");
+    if (at == std::string::npos) return std::nullopt;
+    return std::stoi(line.substr(at + 6));
+}
+
+bool write_line(int fd, const std::string& line) {
+    std::string data = line + '\n';
+    for (size_t written = 0; written < data.size();) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+// Plays one game between two engines and starts again, for the next game, any engine that failed, since it may be
+// dead or out of step. An engine that runs out of time while initializing loses on time.
+GameOutcome play_game(int seed, std::shared_ptr<EngineProcess>& red, std::shared_ptr<EngineProcess>& blue,
+                      const TimeControl& time_control) {
+    auto red_player = std::make_unique<EnginePlayer>(red);
+    auto blue_player = std::make_unique<EnginePlayer>(blue);
+    EnginePlayer* players[] = {red_player.get(), blue_player.get()};
+    try {
+        GameController controller(seed, std::move(red_player), std::move(blue_player), std::make_unique<NullSink>(),
+                                  nullptr, time_control);
+        GameOutcome outcome = controller.run();
+        if (!players[0]->error().empty()) red.reset();
+        if (!players[1]->error().empty()) blue.reset();
+        return outcome;
+    } catch (const InitTimeout& e) {
+        (e.outcome.winner == PlayerColor::Red ? blue : red).reset();
+        return e.outcome;
+    }
+}
+
+// Plays units read from in and writes their results, or "skip <message>", to out until in is closed.
+[[noreturn]] void run_worker(int in, int out, const Options& options, const TimeControl& time_control) {
+    std::vector<std::shared_ptr<EngineProcess>> engines(options.names.size());
+    std::string buffer;
+    char data[4096];
+    ssize_t n;
+    while ((n = read(in, data, sizeof(data))) > 0) {
+        buffer.append(data, n);
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            std::istringstream fields(buffer.substr(0, newline));
+            buffer.erase(0, newline + 1);
+            UnitResult result;
+            fields >> result.unit.id >> result.unit.first >> result.unit.second >> result.unit.seed;
+            try {
+                for (int game = 0; game < 2; ++game) {
+                    int red = game == 0 ? result.unit.first : result.unit.second;
+                    int blue = game == 0 ? result.unit.second : result.unit.first;
+                    for (int participant : {red, blue}) {
+                        if (!engines[participant]) {
+                            engines[participant] = std::make_shared<EngineProcess>(options.commands[participant]);
+                        }
+                    }
+                    GameOutcome outcome = play_game(result.unit.seed, engines[red], engines[blue], time_control);
+                    result.games[game] = {outcome.winner, outcome.reason, outcome.encoded_game};
+                }
+                write_line(out, format_result(result));
+            } catch (const std::exception& e) {
+                // E.g. an engine that cannot be started. Drop both engines, in case one is out of step.
+                engines[result.unit.first].reset();
+                engines[result.unit.second].reset();
+                write_line(out, "skip pair " + std::to_string(result.unit.id) + ": " + e.what());
+            }
+        }
+    }
+    engines.clear();
+    _exit(0);
+}
+
+void start_worker(Worker& worker, std::vector<Worker>& workers, const Options& options,
+                  const TimeControl& time_control) {
+    int to[2], from[2];
+    if (pipe(to) != 0 || pipe(from) != 0) throw std::runtime_error("Cannot create pipes for a worker");
+    worker.pid = fork();
+    if (worker.pid < 0) throw std::runtime_error("Cannot fork a worker");
+    if (worker.pid == 0) {
+        // A process group of its own, shared with its engines, so that a worker that hangs is killed with them.
+        setpgid(0, 0);
+        // Keep only this worker's pipes, so that the others see their input close when the coordinator closes it.
+        for (const Worker& other : workers) {
+            if (other.to >= 0) close(other.to);
+            if (other.from >= 0) close(other.from);
+        }
+        close(to[1]);
+        close(from[0]);
+        run_worker(to[0], from[1], options, time_control);
+    }
+    setpgid(worker.pid, worker.pid);
+    close(to[0]);
+    close(from[1]);
+    worker.to = to[1];
+    worker.from = from[0];
+    worker.buffer.clear();
+    worker.unit.reset();
+}
+
+void stop_worker(Worker& worker) {
+    close(worker.to);
+    close(worker.from);
+    worker.to = worker.from = -1;
+    waitpid(worker.pid, nullptr, 0);
+}
+
+// Adds both games of a pair to the ratings.
+void rate(RatingTable& table, const UnitResult& result) {
+    for (int game = 0; game < 2; ++game) {
+        int red = game == 0 ? result.unit.first : result.unit.second;
+        int blue = game == 0 ? result.unit.second : result.unit.first;
+        bool red_won = result.games[game].winner == PlayerColor::Red;
+        table.add_game(red_won ? red : blue, red_won ? blue : red);
+    }
+}
+
+int usage() {
+    std::cerr << "usage: tournament.exe --engine <name>=<command> --engine <name>=<command>... [--gauntlet]"
+              << " [--rounds <n>] [--workers <n>] [--tc <spec>] [--seed <n>] [--results <file>] [--every <n>]"
+              << " [--pair-timeout <s>]" << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    TimeControl time_control;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--gauntlet") {
+                options.gauntlet = true;
+                continue;
+            }
+            if (i + 1 >= argc) return usage();
+            if (arg == "--engine") {
+                std::string spec = argv[++i];
+                size_t eq = spec.find('=');
+                std::string name = spec.substr(0, eq);
+                if (eq == std::string::npos || name.empty() || name.find_first_of(" ,") != std::string::npos) {
+                    std::cerr << "Engines are given as <name>=<command>, with names free of spaces and commas"
+                              << std::endl;
+                    return usage();
+                }
+                options.names.push_back(name);
+                options.commands.push_back(spec.substr(eq + 1));
+            } else if (arg == "--rounds") {
+                options.rounds = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--workers") {
+                options.workers = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--tc") {
+                options.time_control = argv[++i];
+                time_control = TimeControl::parse(options.time_control);
+            } else if (arg == "--seed") {
+                options.seed = std::stoi(argv[++i]);
+            } else if (arg == "--results") {
+                options.results = argv[++i];
+            } else if (arg == "--every") {
+                options.every = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--pair-timeout") {
+                options.pair_timeout = std::stod(argv[++i]);
+            } else {
+                return usage();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+    if (options.names.size() < 2) return usage();
+    // A worker that dies is noticed when its pipe closes; writing to it must not kill the coordinator.
+    signal(SIGPIPE, SIG_IGN);
+
+    int seed = options.seed.value_or(recorded_seed(options.results).value_or(
+        std::chrono::steady_clock::now().time_since_epoch().count() % (int)(1e9 + 7)));
+    std::vector<WorkUnit> schedule =
+        make_schedule(static_cast<int>(options.names.size()), options.gauntlet, options.rounds, seed);
+
+    std::vector<UnitResult> recorded;
+    std::unique_ptr<ResultsFile> results;
+    try {
+        results = std::make_unique<ResultsFile>(options.results, header(options, seed), recorded);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    RatingTable table(static_cast<int>(options.names.size()));
+    std::vector<bool> done(schedule.size(), false);
+    for (const UnitResult& result : recorded) {
+        const WorkUnit& unit = result.unit;
+        if (unit.id < 0 || unit.id >= (int)schedule.size() || schedule[unit.id].first != unit.first ||
+            schedule[unit.id].second != unit.second || schedule[unit.id].seed != unit.seed || done[unit.id]) {
+            std::cerr << options.results << " does not match the schedule at pair " << unit.id << std::endl;
+            return 1;
+        }
+        done[unit.id] = true;
+        rate(table, result);
+    }
+    table.update();
+    std::deque<WorkUnit> pending;
+    for (const WorkUnit& unit : schedule) {
+        if (!done[unit.id]) pending.push_back(unit);
+    }
+    std::cerr << "seed " << seed << ", " << schedule.size() << " pairs, " << recorded.size() << " already played"
+              << std::endl;
+
+    std::vector<Worker> workers(std::min<size_t>(options.workers, pending.size()));
+    std::vector<int> attempts(schedule.size(), 0);
+    size_t skipped = 0;
+    auto pair_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(options.pair_timeout));
+    std::string error;
+    try {
+        for (Worker& worker : workers) {
+            start_worker(worker, workers, options, time_control);
+        }
+        // Replaces a worker that died or hung. Its pair goes back to the queue, unless it has failed too often.
+        auto restart = [&](Worker& worker, const std::string& why) {
+            const WorkUnit unit = *worker.unit;
+            std::cerr << "worker " << worker.pid << " " << why << " during pair " << unit.id << std::endl;
+            kill(-worker.pid, SIGKILL);
+            stop_worker(worker);
+            start_worker(worker, workers, options, time_control);
+            if (++attempts[unit.id] < MAX_ATTEMPTS) {
+                pending.push_front(unit);
+            } else {
+                std::cerr << "skip pair " << unit.id << ": failed " << MAX_ATTEMPTS << " times" << std::endl;
+                ++skipped;
+            }
+        };
+        size_t played = recorded.size();
+        while (error.empty()) {
+            for (Worker& worker : workers) {
+                if (worker.unit || pending.empty()) continue;
+                worker.unit = pending.front();
+                pending.pop_front();
+                worker.deadline = std::chrono::steady_clock::now() + pair_timeout;
+                const WorkUnit& unit = *worker.unit;
+                if (!write_line(worker.to, std::to_string(unit.id) + ' ' + std::to_string(unit.first) + ' ' +
+                                               std::to_string(unit.second) + ' ' + std::to_string(unit.seed))) {
+                    restart(worker, "died");
+                }
+            }
+            std::vector<pollfd> fds;
+            std::vector<Worker*> busy;
+            auto now = std::chrono::steady_clock::now();
+            auto first_deadline = std::chrono::steady_clock::time_point::max();
+            for (Worker& worker : workers) {
+                if (!worker.unit) continue;
+                fds.push_back({worker.from, POLLIN, 0});
+                busy.push_back(&worker);
+                first_deadline = std::min(first_deadline, worker.deadline);
+            }
+            if (busy.empty()) {
+                if (pending.empty()) break;
+                continue;
+            }
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+                std::max(first_deadline - now, std::chrono::steady_clock::duration::zero()));
+            int timeout = static_cast<int>(std::min<int64_t>(wait.count(), std::numeric_limits<int>::max()));
+            if (poll(fds.data(), fds.size(), timeout) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Cannot wait for the workers");
+            }
+            now = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < busy.size() && error.empty(); ++i) {
+                Worker& worker = *busy[i];
+                if (!fds[i].revents) {
+                    if (now >= worker.deadline) restart(worker, "timed out");
+                    continue;
+                }
+                char data[4096];
+                ssize_t n = read(worker.from, data, sizeof(data));
+                if (n <= 0) {
+                    restart(worker, "died");
+                    continue;
+                }
+                worker.buffer.append(data, n);
+                size_t newline = worker.buffer.find('\n');
+                if (newline == std::string::npos) continue;
+                std::string line = worker.buffer.substr(0, newline);
+                worker.buffer.erase(0, newline + 1);
+                if (line.compare(0, 5, "skip ") == 0) {
+                    // The worker could not play the pair at all, e.g. an engine failed to start.
+                    std::cerr << line << std::endl;
+                    worker.unit.reset();
+                    ++skipped;
+                    continue;
+                }
+                std::optional<UnitResult> result = parse_result(line);
+                if (!result || result->unit.id != worker.unit->id) {
+                    error = "Malformed result: " + line;
+                    break;
+                }
+                worker.unit.reset();
+                results->append(*result);
+                rate(table, *result);
+                table.update();
+                if (++played % options.every == 0 || played == schedule.size()) {
+                    std::cerr << played << " of " << schedule.size() << " pairs\n" << table.format(options.names);
+                }
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    for (Worker& worker : workers) {
+        if (worker.pid > 0 && worker.to >= 0) stop_worker(worker);
+    }
+    if (!error.empty()) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (skipped > 0) {
+        std::cerr << skipped << " pairs skipped; run the same command again to retry them" << std::endl;
+    }
+    std::cout << table.format(options.names);
+    return 0;
+}
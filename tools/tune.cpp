@@ -0,0 +1,314 @@
+// Tunes the parameters a strategy registers with Player::register_parameters by SPSA over self-play.
+//
+//   tune.exe [options]
+//
+// Options:
+//   --iterations <n>    number of SPSA iterations, one game pair each (default 10000)
+//   --threads <n>       number of game pairs played at once (default: all cores)
+//   --tc <spec>         time control, as in wallgo::TimeControl::parse
+//   --seed <n>          seed of the first iteration; iteration k uses seed + k (default: from the clock)
+//   --checkpoint <file> where progress is saved (default tune.ckpt)
+//   --every <n>         save progress every n iterations (default 100)
+//   --resume            continue from the checkpoint instead of the registered values
+//   --r-end <r>         learning rate at the end, relative to each parameter's step squared (default 0.002)
+//
+// Every iteration perturbs all parameters at once by about their step in random directions, plays the two perturbed
+// versions against each other in a pair of games with colors swapped, and moves the parameters towards the winner.
+// Iterations run in parallel; each reads the latest values when it starts. The gain schedules are those of the
+// chess engine testing frameworks: c_k = step * (N / k)^0.101 and a_k = r_end * step^2 * ((A + N) / (A + k))^0.602
+// with A = N / 10. The strategy is linked as red, see tools/compile_tune.sh. The tuned values go to stdout.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_log.h"
+#include "game_controller.h"
+#include "tuning.h"
+#include "types.h"
+
+namespace red {
+std::unique_ptr<wallgo::Player> get();
+}
+
+using namespace wallgo;
+
+namespace {
+
+constexpr double ALPHA = 0.602;
+constexpr double GAMMA = 0.101;
+
+struct Options {
+    uint64_t iterations = 10000;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    TimeControl time_control;
+    int seed = std::chrono::steady_clock::now().time_since_epoch().count() % (int)(1e9 + 7);
+    std::string checkpoint = "tune.ckpt";
+    uint64_t every = 100;
+    bool resume = false;
+    double r_end = 0.002;
+};
+
+// Shared state of the tuner, guarded by mutex.
+struct Tuner {
+    std::mutex mutex;
+    std::vector<ParameterRegistry::Parameter> parameters;
+    std::vector<double> theta;
+    int seed;
+    // Iterations finish out of order: every iteration below frontier is done, and so are those in done_above.
+    uint64_t frontier = 0;
+    std::set<uint64_t> done_above;
+    std::atomic<uint64_t> next_iteration{0};
+
+    uint64_t completed() const { return frontier + done_above.size(); }
+
+    void mark_done(uint64_t k) {
+        done_above.insert(k);
+        while (!done_above.empty() && *done_above.begin() == frontier) {
+            done_above.erase(done_above.begin());
+            ++frontier;
+        }
+    }
+};
+
+// Creates a player with the given parameter values.
+std::unique_ptr<Player> make_player(const std::vector<double>& values) {
+    std::unique_ptr<Player> player = red::get();
+    ParameterRegistry registry;
+    player->register_parameters(registry);
+    for (size_t i = 0; i < values.size(); ++i) {
+        registry.set(i, values[i]);
+    }
+    return player;
+}
+
+// Plays a pair of games between the two parameter sets and returns the wins of plus minus the wins of minus.
+int play_pair(const std::vector<double>& plus, const std::vector<double>& minus, int seed,
+              const TimeControl& time_control) {
+    int result = 0;
+    for (bool plus_is_red : {true, false}) {
+        std::unique_ptr<Player> plus_player = make_player(plus), minus_player = make_player(minus);
+        std::unique_ptr<Player>& p1 = plus_is_red ? plus_player : minus_player;
+        std::unique_ptr<Player>& p2 = plus_is_red ? minus_player : plus_player;
+        GameController controller(seed, std::move(p1), std::move(p2), std::make_unique<NullSink>(), nullptr,
+                                  time_control);
+        GameOutcome outcome = controller.run();
+        result += (outcome.winner == PlayerColor::Red) == plus_is_red ? 1 : -1;
+    }
+    return result;
+}
+
+// Writes the checkpoint to a temporary file first, so that a crash never leaves a partial checkpoint behind.
+bool save_checkpoint(const std::string& path, const Tuner& tuner) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary);
+        out.precision(17);
+        out << "wallgo-spsa 2\n"
+            << "frontier " << tuner.frontier << "\n";
+        for (uint64_t k : tuner.done_above) {
+            out << "done " << k << "\n";
+        }
+        out << "seed " << tuner.seed << "\n";
+        for (size_t i = 0; i < tuner.parameters.size(); ++i) {
+            out << "param " << tuner.parameters[i].name << " " << tuner.theta[i] << "\n";
+        }
+        if (!out.flush()) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// Restores the progress and values of a checkpoint. Parameters missing from it keep their registered values.
+bool load_checkpoint(const std::string& path, Tuner& tuner) {
+    std::ifstream in(path);
+    std::string key, version;
+    if (!(in >> key >> version) || key != "wallgo-spsa" || (version != "1" && version != "2")) return false;
+    while (in >> key) {
+        if (key == "frontier" || key == "completed") {
+            // Version 1 saved a count of finished iterations, which is taken as the frontier.
+            in >> tuner.frontier;
+        } else if (key == "done") {
+            uint64_t k;
+            in >> k;
+            tuner.done_above.insert(k);
+        } else if (key == "seed") {
+            in >> tuner.seed;
+        } else if (key == "param") {
+            std::string name;
+            double value;
+            in >> name >> value;
+            for (size_t i = 0; i < tuner.parameters.size(); ++i) {
+                if (tuner.parameters[i].name == name) tuner.theta[i] = value;
+            }
+        } else {
+            return false;
+        }
+    }
+    return !in.bad();
+}
+
+void print_values(std::ostream& out, const Tuner& tuner) {
+    for (size_t i = 0; i < tuner.parameters.size(); ++i) {
+        const ParameterRegistry::Parameter& parameter = tuner.parameters[i];
+        out << parameter.name << " = ";
+        if (parameter.integer) {
+            out << std::lround(tuner.theta[i]);
+        } else {
+            out << tuner.theta[i];
+        }
+        out << "\n";
+    }
+}
+
+int usage() {
+    std::cerr << "usage: tune.exe [--iterations <n>] [--threads <n>] [--tc <spec>] [--seed <n>] [--checkpoint <file>]"
+              << " [--every <n>] [--resume] [--r-end <r>]" << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--resume") {
+                options.resume = true;
+                continue;
+            }
+            if (i + 1 >= argc) return usage();
+            if (arg == "--iterations") {
+                options.iterations = std::stoull(argv[++i]);
+            } else if (arg == "--threads") {
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--tc") {
+                options.time_control = TimeControl::parse(argv[++i]);
+            } else if (arg == "--seed") {
+                options.seed = std::stoi(argv[++i]);
+            } else if (arg == "--checkpoint") {
+                options.checkpoint = argv[++i];
+            } else if (arg == "--every") {
+                options.every = std::max<uint64_t>(1, std::stoull(argv[++i]));
+            } else if (arg == "--r-end") {
+                options.r_end = std::stod(argv[++i]);
+            } else {
+                return usage();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return usage();
+    }
+
+    Tuner tuner;
+    {
+        ParameterRegistry registry;
+        std::unique_ptr<Player> player = red::get();
+        player->register_parameters(registry);
+        tuner.parameters = registry.parameters();
+    }
+    if (tuner.parameters.empty()) {
+        std::cerr << "The strategy registers no parameters" << std::endl;
+        return 1;
+    }
+    for (const auto& parameter : tuner.parameters) {
+        tuner.theta.push_back(parameter.value);
+    }
+    tuner.seed = options.seed;
+    if (options.resume && !load_checkpoint(options.checkpoint, tuner)) {
+        std::cerr << "Cannot resume from " << options.checkpoint << std::endl;
+        return 1;
+    }
+    tuner.next_iteration = tuner.frontier;
+    const std::set<uint64_t> done_before = tuner.done_above;  // Iterations to skip, read without the lock
+    std::cerr << "seed " << tuner.seed << ", starting at iteration " << tuner.frontier << " of "
+              << options.iterations << " (" << tuner.done_above.size() << " later ones already done)" << std::endl;
+
+    const double n = static_cast<double>(options.iterations);
+    const double a_offset = n / 10;
+
+    NullBuffer null_buffer;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(&null_buffer);
+
+    // Marks iteration k done and saves progress every so often. Called with tuner.mutex held.
+    auto finish = [&](uint64_t k) {
+        tuner.mark_done(k);
+        uint64_t completed = tuner.completed();
+        if (completed % options.every == 0 || completed == options.iterations) {
+            if (!save_checkpoint(options.checkpoint, tuner)) {
+                std::cerr << "Cannot write " << options.checkpoint << std::endl;
+            }
+            std::cerr << "iteration " << completed << ":";
+            for (size_t i = 0; i < tuner.parameters.size(); ++i) {
+                std::cerr << " " << tuner.parameters[i].name << "=" << tuner.theta[i];
+            }
+            std::cerr << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&] {
+            while (true) {
+                uint64_t k = tuner.next_iteration++;
+                if (k >= options.iterations) break;
+                if (done_before.count(k)) continue;
+                int seed = static_cast<int>((tuner.seed + k) % (int)(1e9 + 7));
+
+                std::vector<double> theta;
+                {
+                    std::lock_guard<std::mutex> lock(tuner.mutex);
+                    theta = tuner.theta;
+                }
+                size_t size = theta.size();
+                std::mt19937 rng(seed);
+                std::vector<double> delta(size), c(size), plus(size), minus(size);
+                for (size_t i = 0; i < size; ++i) {
+                    delta[i] = rng() & 1 ? 1 : -1;
+                    c[i] = tuner.parameters[i].step * std::pow(n / (k + 1), GAMMA);
+                    plus[i] = theta[i] + c[i] * delta[i];
+                    minus[i] = theta[i] - c[i] * delta[i];
+                }
+
+                int result;
+                try {
+                    result = play_pair(plus, minus, seed, options.time_control);
+                } catch (const std::exception& e) {
+                    // The controller throws if a player runs out of time while initializing.
+                    std::lock_guard<std::mutex> lock(tuner.mutex);
+                    std::cerr << "Iteration " << k << " skipped: " << e.what() << std::endl;
+                    finish(k);
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(tuner.mutex);
+                for (size_t i = 0; i < size; ++i) {
+                    const ParameterRegistry::Parameter& parameter = tuner.parameters[i];
+                    double a = options.r_end * parameter.step * parameter.step *
+                               std::pow((a_offset + n) / (a_offset + k + 1), ALPHA);
+                    tuner.theta[i] =
+                        std::clamp(tuner.theta[i] + a / c[i] * result * delta[i], parameter.min, parameter.max);
+                }
+                finish(k);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::cout.rdbuf(stdout_buffer);
+
+    print_values(std::cout, tuner);
+    return 0;
+}